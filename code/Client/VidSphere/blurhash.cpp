@@ -0,0 +1,109 @@
+//blurhash.cpp
+//格式：第1个字符为分量数（(ny-1)*9 + (nx-1)），第2个字符为交流分量的最大幅度，
+//之后4个字符为直流分量（平均颜色，sRGB），其余每2个字符为一个交流分量，三个通道各量化为19级
+//所有数字都是base83编码，与服务器 encode_blurhash 对应
+
+#include "blurhash.h"
+
+#include <QtMath>
+#include <QVector>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const char kCharacters[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz#$%*+,-.:;=?@[]^_{|}~";
+
+int decode83(const QString &hash, int from, int to)
+{
+    int value = 0;
+    for (int i = from; i < to; ++i) {
+        char c = hash.at(i).toLatin1();
+        const char *found = c ? std::strchr(kCharacters, c) : nullptr;
+        if (!found) return -1;
+        value = value * 83 + static_cast<int>(found - kCharacters);
+    }
+    return value;
+}
+
+double srgbToLinear(int value)
+{
+    double v = value / 255.0;
+    return v <= 0.04045 ? v / 12.92 : std::pow((v + 0.055) / 1.055, 2.4);
+}
+
+int linearToSrgb(double value)
+{
+    double v = qBound(0.0, value, 1.0);
+    double srgb = v <= 0.0031308 ? v * 12.92 : 1.055 * std::pow(v, 1 / 2.4) - 0.055;
+    return static_cast<int>(srgb * 255 + 0.5);
+}
+
+double signPow(double value, double exp)
+{
+    return std::copysign(std::pow(std::abs(value), exp), value);
+}
+
+}
+
+namespace BlurHash {
+
+QImage decode(const QString &hash, int width, int height)
+{
+    if (hash.size() < 6 || width <= 0 || height <= 0) return QImage();
+
+    int sizeFlag = decode83(hash, 0, 1);
+    if (sizeFlag < 0) return QImage();
+    int nx = sizeFlag % 9 + 1;
+    int ny = sizeFlag / 9 + 1;
+    if (hash.size() != 4 + 2 * nx * ny) return QImage();
+
+    int quantisedMax = decode83(hash, 1, 2);
+    int dc = decode83(hash, 2, 6);
+    if (quantisedMax < 0 || dc < 0) return QImage();
+    double maxValue = (quantisedMax + 1) / 166.0;
+
+    // 各分量的线性RGB
+    QVector<double> colors(nx * ny * 3);
+    colors[0] = srgbToLinear(dc >> 16);
+    colors[1] = srgbToLinear((dc >> 8) & 255);
+    colors[2] = srgbToLinear(dc & 255);
+    for (int i = 1; i < nx * ny; ++i) {
+        int value = decode83(hash, 4 + 2 * i, 6 + 2 * i);
+        if (value < 0) return QImage();
+        colors[i * 3] = signPow((value / (19 * 19) - 9) / 9.0, 2) * maxValue;
+        colors[i * 3 + 1] = signPow((value / 19 % 19 - 9) / 9.0, 2) * maxValue;
+        colors[i * 3 + 2] = signPow((value % 19 - 9) / 9.0, 2) * maxValue;
+    }
+
+    // 余弦值与像素位置无关的部分预先算好
+    QVector<double> cosX(width * nx);
+    for (int x = 0; x < width; ++x) {
+        for (int i = 0; i < nx; ++i) cosX[x * nx + i] = std::cos(M_PI * x * i / width);
+    }
+    QVector<double> cosY(height * ny);
+    for (int y = 0; y < height; ++y) {
+        for (int j = 0; j < ny; ++j) cosY[y * ny + j] = std::cos(M_PI * y * j / height);
+    }
+
+    QImage image(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            double r = 0, g = 0, b = 0;
+            for (int j = 0; j < ny; ++j) {
+                for (int i = 0; i < nx; ++i) {
+                    double basis = cosX[x * nx + i] * cosY[y * ny + j];
+                    const double *color = colors.constData() + (j * nx + i) * 3;
+                    r += color[0] * basis;
+                    g += color[1] * basis;
+                    b += color[2] * basis;
+                }
+            }
+            line[x] = qRgb(linearToSrgb(r), linearToSrgb(g), linearToSrgb(b));
+        }
+    }
+    return image;
+}
+
+}
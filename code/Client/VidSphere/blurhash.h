@@ -0,0 +1,16 @@
+//blurhash.h
+//BlurHash解码：服务器在视频列表中为每个缩略图附带一段约30字符的BlurHash，
+//客户端在缩略图下载完成前把它解码成一张模糊的色块图，列表一出现就有大致的画面
+
+#pragma once
+
+#include <QImage>
+#include <QString>
+
+namespace BlurHash {
+
+// 解码为width x height的图片，格式不正确时返回空图片
+// 结果只包含低频分量，解码成很小的图片再平滑放大即可，不必按显示尺寸解码
+QImage decode(const QString &hash, int width, int height);
+
+}
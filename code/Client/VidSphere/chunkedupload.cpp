@@ -0,0 +1,823 @@
+//chunkedupload.cpp
+//分块上传：每块附带CRC32C，服务器校验不一致返回409时重传该块
+//网络错误和5xx按1、2、4、8、16秒退避重试，出错时窗口减半，重试成功后计数清零
+//窗口：每个请求之间连接要空闲一个往返时间，窗口至少为 1 + RTT/单块传输时间；
+//在此基础上试探性增加，总吞吐提升不足10%时停止
+
+#include "chunkedupload.h"
+#include "chunkreader.h"
+#include "posterextractor.h"
+#include "uploadbodydevice.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHttpMultiPart>
+#include <QJsonDocument>
+#include <QNetworkRequest>
+#include <QtMath>
+
+ChunkedUpload::ChunkedUpload(QNetworkAccessManager *manager,
+                             const QString &serverAddress,
+                             const QString &filePath,
+                             QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_reply(nullptr)
+    , m_reader(nullptr)
+    , m_poster(nullptr)
+    , m_serverAddress(serverAddress)
+    , m_filePath(filePath)
+    , m_step(InitStep)
+    , m_retries(0)
+    , m_bytesAcked(0)
+    , m_bytesTotal(0)
+    , m_bytesSkipped(0)
+    , m_dedup(false)
+    , m_backingOff(false)
+    , m_sessionRestarted(false)
+    , m_done(false)
+    , m_transferAllowed(true)
+    , m_waitingForTransfer(false)
+    , m_window(kInitialWindow)
+    , m_maxWindow(kMaxWindow)
+    , m_throughput(0)
+    , m_rttMs(0)
+    , m_throughputBeforeGrowth(0)
+    , m_settleTicks(0)
+    , m_growthStopped(false)
+    , m_lastBytesSent(0)
+{
+    m_retryTimer.setSingleShot(true);
+    connect(&m_retryTimer, &QTimer::timeout, this, &ChunkedUpload::retryCurrentStep);
+    m_tickTimer.setInterval(kTickMs);
+    connect(&m_tickTimer, &QTimer::timeout, this, &ChunkedUpload::onThroughputTick);
+}
+
+ChunkedUpload::~ChunkedUpload()
+{
+    if (m_reply) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+    }
+    abortChunks();
+}
+
+// 检查文件，在后台线程分析MP4结构
+bool ChunkedUpload::start()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_errorString = "无法打开视频文件: " + file.errorString();
+        return false;
+    }
+    m_bytesTotal = file.size();
+
+    // 缩略图与分析、上传同时进行，提交前等它完成
+    m_poster = new PosterExtractor(this);
+    m_poster->extract(m_filePath);
+
+    m_step = PrepareStep;
+    ensureReader();
+    m_reader->prepare();
+    return true;
+}
+
+// 有未完成的固定分块会话时继续，否则先分块再询问服务器缺少哪些块
+void ChunkedUpload::onPrepared(const FaststartLayout &layout, const QString &errorString)
+{
+    if (m_done) return;
+    if (!errorString.isEmpty()) {
+        fail("读取视频文件失败: " + errorString);
+        return;
+    }
+    m_layout = layout;
+    m_bytesTotal = layout.size;
+    m_reader->setLayout(layout);
+
+    UploadJournal saved;
+    if (saved.load(UploadJournal::journalPath(m_filePath)) && saved.matches(m_filePath, m_serverAddress)
+        && saved.remuxed == m_layout.remuxed) {
+        m_journal = saved;
+        beginTransfer();
+        return;
+    }
+
+    m_step = ScanStep;
+    m_reader->scan();
+}
+
+void ChunkedUpload::ensureReader()
+{
+    if (m_reader) return;
+
+    m_reader = new ChunkReader(m_filePath, this);
+    m_reader->setLayout(m_layout);
+    connect(m_reader, &ChunkReader::prepared, this, &ChunkedUpload::onPrepared);
+    connect(m_reader, &ChunkReader::chunkRead, this, &ChunkedUpload::onChunkRead);
+    connect(m_reader, &ChunkReader::readFailed, this, [this](int, const QString &errorString) {
+        fail("读取视频文件失败: " + errorString);
+    });
+    connect(m_reader, &ChunkReader::scanProgress, this, [this](qint64 bytesScanned) {
+        emit hashingProgress(bytesScanned, m_bytesTotal);
+    });
+    connect(m_reader, &ChunkReader::scanFinished, this, &ChunkedUpload::onScanFinished);
+}
+
+void ChunkedUpload::onScanFinished(const QList<CdcChunk> &chunks, const QString &errorString)
+{
+    if (m_done) return;
+    if (!errorString.isEmpty()) {
+        fail("读取视频文件失败: " + errorString);
+        return;
+    }
+    m_chunks = chunks;
+    beginTransfer();
+}
+
+// 本地分析完成；不允许传输时等待上传队列放行
+void ChunkedUpload::beginTransfer()
+{
+    if (!m_transferAllowed) {
+        m_waitingForTransfer = true;
+        emit readyForTransfer();
+        return;
+    }
+    m_waitingForTransfer = false;
+    if (!m_journal.uploadId.isEmpty()) {
+        sendStatusQuery();
+    } else {
+        sendMissingQuery();
+    }
+}
+
+void ChunkedUpload::setTransferAllowed(bool allowed)
+{
+    m_transferAllowed = allowed;
+    if (allowed && m_waitingForTransfer && !m_done) beginTransfer();
+}
+
+// 设置窗口上限，超出的块在完成后不再补充
+void ChunkedUpload::setMaxWindow(int count)
+{
+    m_maxWindow = qBound(1, count, kMaxWindow);
+    m_window = qMin(m_window, m_maxWindow);
+}
+
+// 询问服务器缺少哪些块
+void ChunkedUpload::sendMissingQuery()
+{
+    m_step = MissingStep;
+
+    QJsonArray hashes;
+    for (const CdcChunk &chunk : std::as_const(m_chunks)) { hashes.append(QString::fromLatin1(chunk.hash)); }
+    QJsonObject params;
+    params["hashes"] = hashes;
+
+    QNetworkRequest request(endpoint("/chunks/missing"));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    m_reply = m_manager->post(request, QJsonDocument(params).toJson(QJsonDocument::Compact));
+
+    // 请求很小，耗时可以作为往返时间的初始估计
+    QElapsedTimer timer;
+    timer.start();
+    connect(m_reply, &QNetworkReply::finished, this, [this, timer]() {
+        addRttSample(timer.elapsed());
+        onMissingFinished();
+    });
+}
+
+void ChunkedUpload::onMissingFinished()
+{
+    QNetworkReply *reply = takeReply();
+    if (m_done) return;
+
+    // 服务器没有去重接口，改用固定大小分块
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 404 || status == 405) {
+        m_chunks.clear();
+        sendInit();
+        return;
+    }
+    if (retryLater(reply)) return;
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(reply->errorString());
+        return;
+    }
+
+    QSet<QByteArray> missing;
+    const QJsonArray missingArray = QJsonDocument::fromJson(reply->readAll()).object()["missing"].toArray();
+    for (const QJsonValue &value : missingArray) { missing.insert(value.toString().toLatin1()); }
+
+    // 文件内部重复的块只上传一次
+    m_dedup = true;
+    m_retries = 0;
+    m_chunkRetries.clear();
+    m_acked = QList<bool>(m_chunks.size(), true);
+    m_bytesAcked = 0;
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        if (missing.remove(m_chunks[i].hash)) {
+            m_acked[i] = false;
+        } else {
+            m_bytesAcked += m_chunks[i].length;
+        }
+    }
+    m_bytesSkipped = m_bytesAcked;
+    startSending();
+}
+
+// 取消上传
+void ChunkedUpload::abort()
+{
+    if (m_done) return;
+    fail("上传已取消");
+}
+
+QUrl ChunkedUpload::endpoint(const QString &path) const
+{
+    return QUrl(m_serverAddress + path);
+}
+
+// 取出当前控制请求的reply，事件循环返回后释放
+QNetworkReply *ChunkedUpload::takeReply()
+{
+    QNetworkReply *reply = m_reply;
+    m_reply = nullptr;
+    reply->deleteLater();
+    return reply;
+}
+
+// 新建上传会话
+void ChunkedUpload::sendInit()
+{
+    m_step = InitStep;
+
+    QJsonObject params;
+    params["filename"] = QFileInfo(m_filePath).fileName();
+    params["size"] = m_bytesTotal;
+
+    QNetworkRequest request(endpoint("/upload/init"));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    m_reply = m_manager->post(request, QJsonDocument(params).toJson(QJsonDocument::Compact));
+
+    // 控制请求很小，耗时可以作为往返时间的初始估计
+    QElapsedTimer timer;
+    timer.start();
+    connect(m_reply, &QNetworkReply::finished, this, [this, timer]() {
+        addRttSample(timer.elapsed());
+        onInitFinished();
+    });
+}
+
+void ChunkedUpload::onInitFinished()
+{
+    QNetworkReply *reply = takeReply();
+    if (m_done) return;
+
+    // 旧版服务器没有分块接口
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 404 || status == 405) {
+        startLegacyUpload();
+        return;
+    }
+    if (retryLater(reply)) return;
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(reply->errorString());
+        return;
+    }
+
+    QJsonObject jsonObj = QJsonDocument::fromJson(reply->readAll()).object();
+    QString uploadId = jsonObj["upload_id"].toString();
+    qint64 chunkSize = jsonObj["chunk_size"].toInteger();
+    if (uploadId.isEmpty() || chunkSize <= 0) {
+        fail("上传响应格式错误");
+        return;
+    }
+
+    m_journal = UploadJournal();
+    m_journal.filePath = QFileInfo(m_filePath).absoluteFilePath();
+    m_journal.fileSize = QFileInfo(m_filePath).size();
+    m_journal.remuxed = m_layout.remuxed;
+    m_journal.lastModified = QFileInfo(m_filePath).lastModified().toMSecsSinceEpoch();
+    m_journal.server = m_serverAddress;
+    beginSession(uploadId, chunkSize, jsonObj["received"].toArray());
+}
+
+// 查询服务器上已收到的块，以服务器为准
+void ChunkedUpload::sendStatusQuery()
+{
+    m_step = StatusStep;
+    m_reply = m_manager->get(QNetworkRequest(endpoint("/upload/" + m_journal.uploadId)));
+
+    QElapsedTimer timer;
+    timer.start();
+    connect(m_reply, &QNetworkReply::finished, this, [this, timer]() {
+        addRttSample(timer.elapsed());
+        onStatusFinished();
+    });
+}
+
+void ChunkedUpload::onStatusFinished()
+{
+    QNetworkReply *reply = takeReply();
+    if (m_done) return;
+
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 404) {
+        restartSession();
+        return;
+    }
+    if (retryLater(reply)) return;
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(reply->errorString());
+        return;
+    }
+
+    QJsonObject jsonObj = QJsonDocument::fromJson(reply->readAll()).object();
+    qint64 chunkSize = jsonObj["chunk_size"].toInteger();
+    if (jsonObj["size"].toInteger(-1) != m_bytesTotal || chunkSize <= 0) {
+        restartSession();
+        return;
+    }
+    beginSession(m_journal.uploadId, chunkSize, jsonObj["received"].toArray());
+}
+
+// 根据服务器已收到的块初始化状态，开始发送剩余的块
+void ChunkedUpload::beginSession(const QString &uploadId, qint64 chunkSize, const QJsonArray &received)
+{
+    m_journal.uploadId = uploadId;
+    m_journal.chunkSize = chunkSize;
+    m_retries = 0;
+    m_chunkRetries.clear();
+
+    int chunkCount = qMax<qint64>(1, (m_bytesTotal + chunkSize - 1) / chunkSize);
+    m_chunks.clear();
+    for (int i = 0; i < chunkCount; ++i) {
+        CdcChunk chunk;
+        chunk.offset = i * chunkSize;
+        chunk.length = qMin(chunkSize, m_bytesTotal - chunk.offset);
+        m_chunks.append(chunk);
+    }
+    m_acked = QList<bool>(chunkCount, false);
+    m_bytesAcked = 0;
+    for (const QJsonValue &value : received) {
+        int index = value.toInt(-1);
+        if (index < 0 || index >= chunkCount || m_acked[index]) continue;
+        m_acked[index] = true;
+        m_bytesAcked += chunkLength(index);
+    }
+    saveJournal();
+    startSending();
+}
+
+// 开始按窗口发送未确认的块
+void ChunkedUpload::startSending()
+{
+    ensureReader();
+    m_step = ChunkStep;
+    m_lastBytesSent = m_bytesAcked;
+    m_windowTimer.start();
+    m_tickTimer.start();
+
+    emit progressChanged(m_bytesAcked, m_bytesTotal);
+    fillWindow();
+}
+
+// 服务器丢失了会话（过期或被清理），丢弃日志重新开始一次
+void ChunkedUpload::restartSession()
+{
+    if (m_dedup) {
+        fail("服务器拒绝了上传的数据块");
+        return;
+    }
+    if (m_sessionRestarted) {
+        fail("服务器上的上传会话已失效");
+        return;
+    }
+    m_sessionRestarted = true;
+
+    m_tickTimer.stop();
+    abortChunks();
+    UploadJournal::remove(UploadJournal::journalPath(m_filePath));
+    sendInit();
+}
+
+qint64 ChunkedUpload::chunkLength(int index) const
+{
+    return m_chunks[index].length;
+}
+
+// 已确认的字节加上传输中的块已发出的字节
+qint64 ChunkedUpload::currentBytesSent() const
+{
+    qint64 sent = m_bytesAcked;
+    for (const InFlight &inFlight : m_inFlight) { sent += inFlight.bytesSent; }
+    return sent;
+}
+
+// 按块号顺序补足发送窗口，全部确认后提交
+void ChunkedUpload::fillWindow()
+{
+    if (m_done || m_backingOff || m_step != ChunkStep) return;
+
+    if (m_inFlight.isEmpty() && !m_acked.contains(false)) {
+        m_tickTimer.stop();
+        sendCommit();
+        return;
+    }
+
+    for (int index = 0; index < m_acked.size() && m_inFlight.size() < m_window; ++index) {
+        if (m_acked[index] || m_inFlight.contains(index)) continue;
+        if (!m_ready.contains(index)) break;  // 等待预读，保持按顺序发送
+        sendChunk(index, m_ready.take(index));
+    }
+    prefetch();
+}
+
+// 预读窗口之后的块，预读中和已读好的块总数不超过 窗口+kPrefetchChunks
+void ChunkedUpload::prefetch()
+{
+    int budget = m_window + kPrefetchChunks - m_inFlight.size() - m_ready.size() - m_reading.size();
+    for (int index = 0; index < m_acked.size() && budget > 0; ++index) {
+        if (m_acked[index] || m_inFlight.contains(index) || m_ready.contains(index) || m_reading.contains(index)) continue;
+        m_reading.insert(index);
+        m_reader->read(index, m_chunks[index].offset, m_chunks[index].length);
+        budget--;
+    }
+}
+
+void ChunkedUpload::onChunkRead(int index, const QByteArray &data, quint32 crc)
+{
+    if (!m_reading.remove(index) || m_done) return;
+
+    Chunk chunk;
+    chunk.data = data;
+    chunk.crc = crc;
+    m_ready.insert(index, chunk);
+    fillWindow();
+}
+
+void ChunkedUpload::sendChunk(int index, const Chunk &chunk)
+{
+    QString path = m_dedup ? "/chunks/" + QString::fromLatin1(m_chunks[index].hash)
+                           : QString("/upload/%1/chunks/%2").arg(m_journal.uploadId).arg(index);
+    QNetworkRequest request(endpoint(path));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+    request.setRawHeader("X-Checksum-CRC32C", QByteArray::number(chunk.crc, 16).rightJustified(8, '0'));
+
+    InFlight inFlight;
+    inFlight.reply = m_manager->put(request, chunk.data);
+    m_inFlight.insert(index, inFlight);
+
+    connect(inFlight.reply, &QNetworkReply::uploadProgress, this, [this, index](qint64 bytesSent, qint64 bytesTotal) {
+        onChunkUploadProgress(index, bytesSent, bytesTotal);
+    });
+    connect(inFlight.reply, &QNetworkReply::finished, this, [this, index]() { onChunkFinished(index); });
+}
+
+void ChunkedUpload::onChunkUploadProgress(int index, qint64 bytesSent, qint64 bytesTotal)
+{
+    auto it = m_inFlight.find(index);
+    if (it == m_inFlight.end()) return;
+
+    it->bytesSent = bytesSent;
+    if (bytesTotal > 0 && bytesSent == bytesTotal && !it->lastByteTimer.isValid()) { it->lastByteTimer.start(); }
+    emit progressChanged(currentBytesSent(), m_bytesTotal);
+}
+
+void ChunkedUpload::onChunkFinished(int index)
+{
+    InFlight inFlight = m_inFlight.take(index);
+    QNetworkReply *reply = inFlight.reply;
+    reply->deleteLater();
+    if (m_done) return;
+
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 404) {
+        restartSession();
+        return;
+    }
+    if (retryLater(reply, index)) return;
+    if (reply->error() != QNetworkReply::NoError) {
+        fail(reply->errorString());
+        return;
+    }
+
+    if (inFlight.lastByteTimer.isValid()) { addRttSample(inFlight.lastByteTimer.elapsed()); }
+    m_acked[index] = true;
+    m_bytesAcked += chunkLength(index);
+    m_chunkRetries.remove(index);
+    saveJournal();
+
+    emit progressChanged(currentBytesSent(), m_bytesTotal);
+    fillWindow();
+}
+
+// 每秒统计吞吐量并调整窗口
+void ChunkedUpload::onThroughputTick()
+{
+    double elapsed = m_windowTimer.restart() / 1000.0;
+    if (elapsed <= 0 || m_done) return;
+
+    qint64 sent = currentBytesSent();
+    double current = qMax<qint64>(0, sent - m_lastBytesSent) / elapsed;
+    m_lastBytesSent = sent;
+    m_throughput = m_throughput > 0 ? 0.7 * m_throughput + 0.3 * current : current;
+
+    // 单块传输时间内连接忙碌，响应往返期间空闲，窗口要覆盖这段空闲
+    if (m_rttMs > 0 && m_throughput > 0 && !m_inFlight.isEmpty()) {
+        double perConnection = m_throughput / m_inFlight.size();
+        double averageChunk = double(m_bytesTotal) / qMax<qsizetype>(1, m_chunks.size());
+        double chunkSeconds = averageChunk / qMax(perConnection, 1.0);
+        int minWindow = 1 + qCeil(m_rttMs / 1000.0 / chunkSeconds);
+        m_window = qMin(m_maxWindow, qMax(m_window, minWindow));
+    }
+
+    // 高延迟链路上单个连接受TCP窗口限制，再试探性增加连接
+    if (!m_growthStopped) {
+        if (m_throughputBeforeGrowth > 0) {
+            // 一个块的传输需要几秒，经过三个周期再评估
+            if (++m_settleTicks >= 3) {
+                if (m_throughput < m_throughputBeforeGrowth * 1.10) {
+                    m_growthStopped = true;
+                    m_window = qMin(m_maxWindow, qMax(kInitialWindow, m_window - 1));
+                }
+                m_throughputBeforeGrowth = 0;
+            }
+        } else if (m_window < m_maxWindow && m_inFlight.size() >= m_window) {
+            m_throughputBeforeGrowth = m_throughput;
+            m_settleTicks = 0;
+            m_window++;
+        }
+    }
+
+    fillWindow();
+}
+
+void ChunkedUpload::addRttSample(qint64 ms)
+{
+    m_rttMs = m_rttMs > 0 ? 0.8 * m_rttMs + 0.2 * ms : ms;
+}
+
+// 关闭所有块请求并丢弃预读结果
+void ChunkedUpload::abortChunks()
+{
+    for (const InFlight &inFlight : std::as_const(m_inFlight)) {
+        inFlight.reply->disconnect(this);
+        inFlight.reply->abort();
+        inFlight.reply->deleteLater();
+    }
+    m_inFlight.clear();
+    m_ready.clear();
+    m_reading.clear();
+
+    // 断开读取器，尚未送达的预读结果随之丢弃；可能正处于它的信号中，延迟删除
+    if (m_reader) {
+        m_reader->disconnect(this);
+        m_reader->deleteLater();
+        m_reader = nullptr;
+    }
+}
+
+// 所有块都已确认，请求服务器合并；去重模式下提交块清单
+void ChunkedUpload::sendCommit()
+{
+    m_step = CommitStep;
+    if (waitForPoster()) return;
+
+    QJsonObject params;
+    addSidecar(params);
+    if (m_dedup) {
+        QJsonArray hashes;
+        for (const CdcChunk &chunk : std::as_const(m_chunks)) { hashes.append(QString::fromLatin1(chunk.hash)); }
+        params["filename"] = QFileInfo(m_filePath).fileName();
+        params["size"] = m_bytesTotal;
+        params["chunks"] = hashes;
+
+        QNetworkRequest request(endpoint("/upload/manifest"));
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        m_reply = m_manager->post(request, QJsonDocument(params).toJson(QJsonDocument::Compact));
+    } else {
+        QNetworkRequest request(endpoint("/upload/" + m_journal.uploadId + "/commit"));
+        request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+        m_reply = m_manager->post(request, QJsonDocument(params).toJson(QJsonDocument::Compact));
+    }
+    connect(m_reply, &QNetworkReply::finished, this, &ChunkedUpload::onCommitFinished);
+}
+
+void ChunkedUpload::onCommitFinished()
+{
+    QNetworkReply *reply = takeReply();
+    if (m_done) return;
+
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    // 服务器缺少部分块（例如暂存文件损坏后被清理），补传这些块
+    // 固定分块时返回块号，去重模式下返回块哈希
+    if (status == 409) {
+        const QJsonArray missing = QJsonDocument::fromJson(reply->readAll()).object()["missing"].toArray();
+        for (const QJsonValue &value : missing) {
+            int index = value.toInt(-1);
+            if (value.isString()) {
+                QByteArray hash = value.toString().toLatin1();
+                index = -1;
+                for (int i = 0; i < m_chunks.size() && index < 0; ++i) {
+                    if (m_chunks[i].hash == hash) index = i;
+                }
+            }
+            if (index < 0 || index >= m_acked.size() || !m_acked[index]) continue;
+            m_acked[index] = false;
+            m_bytesAcked -= chunkLength(index);
+        }
+        if (!missing.isEmpty() && !m_sessionRestarted) {
+            m_sessionRestarted = true;
+            saveJournal();
+            m_step = ChunkStep;
+            m_tickTimer.start();
+            fillWindow();
+            return;
+        }
+    }
+    if (status == 404) {
+        restartSession();
+        return;
+    }
+    if (retryLater(reply)) return;
+    if (!parseResult(reply)) return;
+
+    UploadJournal::remove(UploadJournal::journalPath(m_filePath));
+    m_done = true;
+    abortChunks();
+    emit progressChanged(m_bytesTotal, m_bytesTotal);
+    emit finished(true);
+}
+
+// 旧版服务器：整个文件作为一个multipart请求上传
+void ChunkedUpload::startLegacyUpload()
+{
+    m_step = LegacyStep;
+    if (waitForPoster()) return;
+
+    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+    QHttpPart videoPart;
+    videoPart.setHeader(QNetworkRequest::ContentDispositionHeader,
+                        QVariant("form-data; name=\"video\"; filename=\"" + QFileInfo(m_filePath).fileName() + "\""));
+
+    // 文件由后台线程预读，网络层在GUI线程读取请求体时不会卡在磁盘上
+    UploadBodyDevice *file = new UploadBodyDevice(m_filePath, m_layout, multiPart); // 让 QHttpMultiPart 管理文件的生命周期
+    if (!file->open(QIODevice::ReadOnly)) {
+        QString errorString = file->errorString();
+        delete multiPart;
+        fail("无法打开视频文件: " + errorString);
+        return;
+    }
+    videoPart.setBodyDevice(file);
+    multiPart->append(videoPart);
+
+    // 客户端生成的缩略图和元数据作为额外的表单部分
+    QJsonObject sidecar;
+    addSidecar(sidecar);
+    if (sidecar.contains("thumbnail")) {
+        QHttpPart thumbnailPart;
+        thumbnailPart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("image/jpeg"));
+        thumbnailPart.setHeader(QNetworkRequest::ContentDispositionHeader,
+                                QVariant("form-data; name=\"thumbnail\"; filename=\"poster.jpg\""));
+        thumbnailPart.setBody(m_poster->getThumbnail());
+        multiPart->append(thumbnailPart);
+    }
+    if (sidecar.contains("metadata")) {
+        QHttpPart metadataPart;
+        metadataPart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant("form-data; name=\"metadata\""));
+        metadataPart.setBody(QJsonDocument(sidecar["metadata"].toObject()).toJson(QJsonDocument::Compact));
+        multiPart->append(metadataPart);
+    }
+
+    m_reply = m_manager->post(QNetworkRequest(endpoint("/upload")), multiPart);
+    multiPart->setParent(m_reply); // 让 QNetworkReply 管理 QHttpMultiPart 的生命周期
+    connect(m_reply, &QNetworkReply::uploadProgress, this, [this](qint64 bytesSent, qint64) {
+        emit progressChanged(bytesSent, m_bytesTotal);
+    });
+    connect(m_reply, &QNetworkReply::finished, this, &ChunkedUpload::onLegacyFinished);
+}
+
+void ChunkedUpload::onLegacyFinished()
+{
+    QNetworkReply *reply = takeReply();
+    if (m_done) return;
+    if (!parseResult(reply)) return;
+
+    m_done = true;
+    emit progressChanged(m_bytesTotal, m_bytesTotal);
+    emit finished(true);
+}
+
+// 解析完成响应：{"success": true, "filename": ...} 或 {"error": ...}
+bool ChunkedUpload::parseResult(QNetworkReply *reply)
+{
+    QJsonObject jsonObj = QJsonDocument::fromJson(reply->readAll()).object();
+    if (reply->error() == QNetworkReply::NoError && jsonObj["success"].toBool()) {
+        m_response = jsonObj;
+        return true;
+    }
+
+    QString errorMsg = jsonObj["error"].toString();
+    fail(errorMsg.isEmpty() ? (reply->error() != QNetworkReply::NoError ? reply->errorString() : "上传响应格式错误")
+                            : errorMsg);
+    return false;
+}
+
+// 网络错误、5xx和块校验失败可以重试，超过次数后放弃（日志保留，下次继续）
+// 块请求按块号各自计数，其他块成功不会让一直失败的块无限重试
+bool ChunkedUpload::retryLater(QNetworkReply *reply, int chunkIndex)
+{
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool transient = (status == 0 && reply->error() != QNetworkReply::NoError)
+                     || status >= 500
+                     || (status == 409 && m_step == ChunkStep);
+    if (!transient) return false;
+
+    int &retries = chunkIndex >= 0 ? m_chunkRetries[chunkIndex] : m_retries;
+    if (retries >= kMaxRetries) {
+        fail(status == 409 ? QString("数据块多次校验失败") : reply->errorString());
+        return true;
+    }
+    retries++;
+
+    // 同一次退避中其他块的失败不再减小窗口；块未确认，定时器到期后由fillWindow重新发送
+    if (m_step == ChunkStep && m_backingOff) return true;
+
+    // 拥塞或服务器过载时减小窗口，退避期间不发送新块，已在传输中的块继续
+    if (m_step == ChunkStep) {
+        m_window = qMax(1, m_window / 2);
+        m_growthStopped = true;
+        m_backingOff = true;
+    }
+    m_retryTimer.start(kRetryBaseMs << (retries - 1));
+    return true;
+}
+
+void ChunkedUpload::retryCurrentStep()
+{
+    if (m_done) return;
+
+    switch (m_step) {
+    case PrepareStep:
+    case ScanStep: break;
+    case MissingStep: sendMissingQuery(); break;
+    case InitStep: sendInit(); break;
+    case StatusStep: sendStatusQuery(); break;
+    case ChunkStep:
+        m_backingOff = false;
+        fillWindow();
+        break;
+    case CommitStep: sendCommit(); break;
+    case LegacyStep: startLegacyUpload(); break;
+    }
+}
+
+// 缩略图还没生成好时，等它完成后重新执行当前步骤
+bool ChunkedUpload::waitForPoster()
+{
+    if (!m_poster || m_poster->isFinished()) return false;
+    connect(m_poster, &PosterExtractor::finished, this, &ChunkedUpload::retryCurrentStep, Qt::SingleShotConnection);
+    return true;
+}
+
+// 缩略图（base64的JPEG）和元数据，生成失败的部分不发送，由服务器自己生成
+void ChunkedUpload::addSidecar(QJsonObject &params) const
+{
+    if (!m_poster) return;
+    if (!m_poster->getMetadata().isEmpty()) params["metadata"] = m_poster->getMetadata();
+    if (!m_poster->getThumbnail().isEmpty()) params["thumbnail"] = QString::fromLatin1(m_poster->getThumbnail().toBase64());
+}
+
+// 去重模式下已上传的块暂存在服务器上，重新询问即可续传，不需要日志
+void ChunkedUpload::saveJournal()
+{
+    if (m_dedup) return;
+
+    m_journal.ackedChunks.clear();
+    for (int i = 0; i < m_acked.size(); ++i) {
+        if (m_acked[i]) m_journal.ackedChunks.append(i);
+    }
+    m_journal.save(UploadJournal::journalPath(m_filePath));
+}
+
+// 失败：日志保留，下次上传同一文件时继续
+void ChunkedUpload::fail(const QString &message)
+{
+    if (m_done) return;
+    m_done = true;
+    m_errorString = message;
+    m_retryTimer.stop();
+    m_tickTimer.stop();
+
+    if (m_reply) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+        m_reply = nullptr;
+    }
+    abortChunks();
+    emit finished(false);
+}
@@ -0,0 +1,179 @@
+//chunkedupload.h
+//分块上传：POST /upload/init 建立会话，按块 PUT /upload/<id>/chunks/<n>，全部确认后 POST commit
+//已确认的块记入日志，断线时按退避重试，客户端重启后再次上传同一文件会从服务器已收到的位置继续
+//同时保持多个块在传输中，窗口大小根据实测吞吐量和往返时间调整；块由后台线程预读
+//去重：先用FastCDC对文件分块，POST /chunks/missing 询问服务器缺少的块，只 PUT /chunks/<sha256> 这些块，
+//最后 POST /upload/manifest 提交块清单；服务器没有去重接口时使用固定大小分块
+//服务器不支持分块上传（init返回404）时退回单个multipart POST /upload
+//上传前先把MP4的moov移到前面（见mp4faststart.h），服务器上的视频下载到开头就能播放
+//同时在客户端生成缩略图和元数据（见posterextractor.h），随提交请求一起发送
+//批量上传时可以先只做本地分析，由上传队列决定何时开始网络传输（见uploadmanager.h）
+
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSet>
+#include <QTimer>
+#include "fastcdc.h"
+#include "networklimits.h"
+#include "uploadjournal.h"
+
+class ChunkReader;
+class PosterExtractor;
+
+class ChunkedUpload : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChunkedUpload(QNetworkAccessManager *manager,
+                           const QString &serverAddress,
+                           const QString &filePath,
+                           QObject *parent = nullptr);
+    ~ChunkedUpload();
+
+    bool start();  // 检查文件并开始上传，失败时返回false
+    void abort();  // 取消上传，已确认的块保留在服务器上，下次继续
+    void setTransferAllowed(bool allowed);  // 不允许时分析完成后发出readyForTransfer并等待，默认允许
+    void setMaxWindow(int count);  // 窗口上限，多个上传同时传输时由上传管理器分配
+
+    QString getFilePath() const { return m_filePath; }
+    QString getErrorString() const { return m_errorString; }
+    QJsonObject getResponse() const { return m_response; }  // 服务器的完成响应（filename、url等）
+    qint64 getBytesSent() const { return m_bytesAcked; }
+    qint64 getBytesTotal() const { return m_bytesTotal; }  // 上传数据流的长度，MP4改写后可能比文件略大
+    qint64 getBytesSkipped() const { return m_bytesSkipped; }  // 服务器已有、无需上传的字节数
+    int getWindowSize() const { return m_window; }
+    bool isWaitingForTransfer() const { return m_waitingForTransfer; }
+
+signals:
+    void progressChanged(qint64 bytesSent, qint64 bytesTotal);
+    void hashingProgress(qint64 bytesHashed, qint64 bytesTotal);  // 上传前分块计算哈希的进度
+    void readyForTransfer();  // 本地分析已完成，等待setTransferAllowed(true)
+    void finished(bool success);
+
+private slots:
+    void onPrepared(const FaststartLayout &layout, const QString &errorString);
+    void onChunkRead(int index, const QByteArray &data, quint32 crc);
+    void onScanFinished(const QList<CdcChunk> &chunks, const QString &errorString);
+    void onThroughputTick();
+
+private:
+    // 当前进行中的控制请求，用于出错后重试同一步
+    enum Step {
+        PrepareStep,
+        ScanStep,
+        MissingStep,
+        InitStep,
+        StatusStep,
+        ChunkStep,
+        CommitStep,
+        LegacyStep
+    };
+
+    // 预读好的块
+    struct Chunk
+    {
+        QByteArray data;
+        quint32 crc = 0;
+    };
+
+    // 正在传输的块
+    struct InFlight
+    {
+        QNetworkReply *reply = nullptr;
+        qint64 bytesSent = 0;
+        QElapsedTimer lastByteTimer;  // 最后一个字节发出后开始计时，到响应到达即为一次往返
+    };
+
+    void beginTransfer();
+    void sendMissingQuery();
+    void onMissingFinished();
+    void sendInit();
+    void onInitFinished();
+    void sendStatusQuery();
+    void onStatusFinished();
+    void fillWindow();
+    void prefetch();
+    void sendChunk(int index, const Chunk &chunk);
+    void onChunkUploadProgress(int index, qint64 bytesSent, qint64 bytesTotal);
+    void onChunkFinished(int index);
+    void sendCommit();
+    void onCommitFinished();
+    void startLegacyUpload();
+    void onLegacyFinished();
+
+    void beginSession(const QString &uploadId, qint64 chunkSize, const QJsonArray &received);
+    void startSending();
+    bool waitForPoster();
+    void addSidecar(QJsonObject &params) const;
+    void ensureReader();
+    void restartSession();               // 服务器上的会话已不存在，重新建立
+    void abortChunks();
+    bool retryLater(QNetworkReply *reply, int chunkIndex = -1);
+    void retryCurrentStep();
+    bool parseResult(QNetworkReply *reply);
+    void addRttSample(qint64 ms);
+    qint64 chunkLength(int index) const;
+    qint64 currentBytesSent() const;
+    void saveJournal();
+    QNetworkReply *takeReply();
+    QUrl endpoint(const QString &path) const;
+    void fail(const QString &message);
+
+    static constexpr int kMaxRetries = 5;
+    static constexpr int kRetryBaseMs = 1000;  // 重试间隔从1秒开始翻倍
+    static constexpr int kInitialWindow = 2;
+    static constexpr int kMaxWindow = NetworkLimits::kConnectionsPerHost;
+    static constexpr int kPrefetchChunks = 2;  // 窗口之外额外预读的块数，内存上限为 (窗口+2) 个块
+    static constexpr int kTickMs = 1000;
+
+    QNetworkAccessManager *m_manager;
+    QNetworkReply *m_reply;      // 控制请求（init、状态查询、提交、旧版上传）
+    ChunkReader *m_reader;
+    PosterExtractor *m_poster;
+    QString m_serverAddress;
+    QString m_filePath;
+    QString m_errorString;
+    QJsonObject m_response;
+    UploadJournal m_journal;
+    FaststartLayout m_layout;        // 上传数据流的组成
+    QList<CdcChunk> m_chunks;        // 各块的位置，去重模式下还有SHA-256
+    QList<bool> m_acked;             // 各块是否已被服务器确认
+    QHash<int, InFlight> m_inFlight; // 正在传输的块
+    QMap<int, Chunk> m_ready;        // 已预读、等待发送的块
+    QSet<int> m_reading;             // 正在预读的块
+    QTimer m_retryTimer;
+    Step m_step;
+    int m_retries;                   // 控制请求的连续失败次数
+    QHash<int, int> m_chunkRetries;  // 各块的失败次数，块确认后清除
+    qint64 m_bytesAcked;
+    qint64 m_bytesTotal;
+    qint64 m_bytesSkipped;
+    bool m_dedup;                    // 内容定义分块去重模式
+    bool m_backingOff;               // 出错后等待重试，暂停发送新块
+    bool m_sessionRestarted;
+    bool m_done;
+    bool m_transferAllowed;
+    bool m_waitingForTransfer;
+
+    // 窗口自适应
+    QTimer m_tickTimer;
+    QElapsedTimer m_windowTimer;
+    int m_window;
+    int m_maxWindow;
+    double m_throughput;             // 字节/秒，指数平滑
+    double m_rttMs;                  // 往返时间，指数平滑
+    double m_throughputBeforeGrowth;
+    int m_settleTicks;
+    bool m_growthStopped;
+    qint64 m_lastBytesSent;
+};
@@ -0,0 +1,70 @@
+//chunkreader.cpp
+//单线程顺序读盘，多个线程同时读同一个文件在机械硬盘上反而更慢
+
+#include "chunkreader.h"
+#include "crc32c.h"
+#include <QFile>
+
+ChunkReader::ChunkReader(const QString &filePath, QObject *parent)
+    : QObject(parent)
+    , m_filePath(filePath)
+    , m_cancelled(false)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+ChunkReader::~ChunkReader()
+{
+    m_cancelled = true;
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void ChunkReader::prepare()
+{
+    m_pool.start([this]() {
+        FaststartLayout layout;
+        QString errorString;
+        Mp4Faststart::plan(m_filePath, &layout, &errorString);
+        if (m_cancelled) return;
+
+        QMetaObject::invokeMethod(this, [this, layout, errorString]() { emit prepared(layout, errorString); },
+                                  Qt::QueuedConnection);
+    });
+}
+
+void ChunkReader::read(int index, qint64 offset, qint64 length)
+{
+    m_pool.start([this, layout = m_layout, index, offset, length]() {
+        if (m_cancelled) return;
+
+        QFile file(m_filePath);
+        QByteArray data(length, Qt::Uninitialized);
+        bool ok = file.open(QIODevice::ReadOnly) && layout.read(file, nullptr, offset, data.data(), length);
+        if (!ok) {
+            QString errorString = file.error() != QFileDevice::NoError ? file.errorString() : QString("文件读取不完整");
+            QMetaObject::invokeMethod(this, [this, index, errorString]() { emit readFailed(index, errorString); },
+                                      Qt::QueuedConnection);
+            return;
+        }
+
+        quint32 crc = Crc32c::update(0, data.constData(), data.size());
+        QMetaObject::invokeMethod(this, [this, index, data, crc]() { emit chunkRead(index, data, crc); },
+                                  Qt::QueuedConnection);
+    });
+}
+
+void ChunkReader::scan()
+{
+    m_pool.start([this, layout = m_layout]() {
+        QString errorString;
+        QList<CdcChunk> chunks = FastCdc::chunkFile(m_filePath, layout, m_cancelled, [this](qint64 bytesScanned) {
+            QMetaObject::invokeMethod(this, [this, bytesScanned]() { emit scanProgress(bytesScanned); },
+                                      Qt::QueuedConnection);
+        }, &errorString);
+        if (m_cancelled) return;
+
+        QMetaObject::invokeMethod(this, [this, chunks, errorString]() { emit scanFinished(chunks, errorString); },
+                                  Qt::QueuedConnection);
+    });
+}
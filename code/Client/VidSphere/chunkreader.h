@@ -0,0 +1,42 @@
+//chunkreader.h
+//上传预读：在后台线程读取文件块并计算CRC32C，读好的块通过chunkRead信号回到调用线程
+//去重上传前也在这个线程上对整个文件做内容定义分块
+//读取的是上传数据流（MP4可能已把moov移到前面），偏移都是数据流中的偏移
+//GUI线程不再因磁盘读取而卡顿，发送窗口中的请求结束时下一块通常已经准备好
+
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QThreadPool>
+#include <atomic>
+#include "fastcdc.h"
+#include "mp4faststart.h"
+
+class ChunkReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChunkReader(const QString &filePath, QObject *parent = nullptr);
+    ~ChunkReader();
+
+    void setLayout(const FaststartLayout &layout) { m_layout = layout; }
+
+    void prepare();                                      // 异步分析MP4结构，完成后发出prepared
+    void read(int index, qint64 offset, qint64 length);  // 异步读取，完成后发出chunkRead或readFailed
+    void scan();                                         // 异步分块并计算各块SHA-256，完成后发出scanFinished
+
+signals:
+    void prepared(const FaststartLayout &layout, const QString &errorString);
+    void chunkRead(int index, const QByteArray &data, quint32 crc);
+    void readFailed(int index, const QString &errorString);
+    void scanProgress(qint64 bytesScanned);
+    void scanFinished(const QList<CdcChunk> &chunks, const QString &errorString);
+
+private:
+    QThreadPool m_pool;
+    QString m_filePath;
+    FaststartLayout m_layout;
+    std::atomic<bool> m_cancelled;
+};
@@ -0,0 +1,190 @@
+//crc32c.cpp
+//查表法使用slicing-by-8，每次处理8字节；硬件路径每条指令处理8字节
+//combine按zlib crc32_combine的做法，在GF(2)上计算 crcA * x^(8*lengthB) mod P
+
+#include "crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+constexpr uint32_t kPolynomial = 0x82F63B78;  // CRC32C多项式（反射形式）
+
+// 8张表，table[k][b]表示字节b后面再跟k个0字节时的CRC
+constexpr std::array<std::array<uint32_t, 256>, 8> makeTables()
+{
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t b = 0; b < 256; ++b) {
+        uint32_t crc = b;
+        for (int i = 0; i < 8; ++i) { crc = (crc & 1) ? (crc >> 1) ^ kPolynomial : crc >> 1; }
+        tables[0][b] = crc;
+    }
+    for (uint32_t b = 0; b < 256; ++b) {
+        for (int k = 1; k < 8; ++k) { tables[k][b] = (tables[k - 1][b] >> 8) ^ tables[0][tables[k - 1][b] & 0xFF]; }
+    }
+    return tables;
+}
+
+constexpr auto kTables = makeTables();
+
+uint32_t updateSoftware(uint32_t crc, const unsigned char *p, size_t length)
+{
+    while (length >= 8) {
+        uint32_t lo;
+        uint32_t hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= crc;  // 小端序
+        crc = kTables[7][lo & 0xFF] ^ kTables[6][(lo >> 8) & 0xFF] ^ kTables[5][(lo >> 16) & 0xFF]
+              ^ kTables[4][lo >> 24] ^ kTables[3][hi & 0xFF] ^ kTables[2][(hi >> 8) & 0xFF]
+              ^ kTables[1][(hi >> 16) & 0xFF] ^ kTables[0][hi >> 24];
+        p += 8;
+        length -= 8;
+    }
+    while (length--) { crc = (crc >> 8) ^ kTables[0][(crc ^ *p++) & 0xFF]; }
+    return crc;
+}
+
+#if defined(CRC32C_X86)
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+uint32_t updateHardware(uint32_t crc, const unsigned char *p, size_t length)
+{
+    uint64_t crc64 = crc;
+    while (length >= 8) {
+        uint64_t value;
+        std::memcpy(&value, p, 8);
+        crc64 = _mm_crc32_u64(crc64, value);
+        p += 8;
+        length -= 8;
+    }
+    uint32_t crc32 = static_cast<uint32_t>(crc64);
+    while (length--) { crc32 = _mm_crc32_u8(crc32, *p++); }
+    return crc32;
+}
+
+bool detectHardware()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;  // ECX.SSE4_2
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#elif defined(CRC32C_ARM)
+
+uint32_t updateHardware(uint32_t crc, const unsigned char *p, size_t length)
+{
+    while (length >= 8) {
+        uint64_t value;
+        std::memcpy(&value, p, 8);
+        crc = __crc32cd(crc, value);
+        p += 8;
+        length -= 8;
+    }
+    while (length--) { crc = __crc32cb(crc, *p++); }
+    return crc;
+}
+
+bool detectHardware()
+{
+    return true;  // 编译期已确认目标CPU支持CRC指令
+}
+
+#else
+
+uint32_t updateHardware(uint32_t crc, const unsigned char *p, size_t length)
+{
+    return updateSoftware(crc, p, length);
+}
+
+bool detectHardware()
+{
+    return false;
+}
+
+#endif
+
+const bool kHardware = detectHardware();
+
+// GF(2)上的乘法 a*b mod P
+uint32_t multiplyModP(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31;
+    uint32_t product = 0;
+    for (;;) {
+        if (a & m) {
+            product ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ kPolynomial : b >> 1;
+    }
+    return product;
+}
+
+// x^(2^k) mod P，k = 0..31
+std::array<uint32_t, 32> makePowerTable()
+{
+    std::array<uint32_t, 32> table{};
+    uint32_t p = 1u << 30;  // x^1
+    table[0] = p;
+    for (int k = 1; k < 32; ++k) { table[k] = p = multiplyModP(p, p); }
+    return table;
+}
+
+const std::array<uint32_t, 32> kPowers = makePowerTable();
+
+// x^(n * 2^k) mod P
+uint32_t powerModP(uint64_t n, unsigned k)
+{
+    uint32_t p = 1u << 31;  // x^0
+    while (n) {
+        if (n & 1) { p = multiplyModP(kPowers[k & 31], p); }
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+}
+
+namespace Crc32c {
+
+uint32_t update(uint32_t crc, const void *data, size_t length)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    crc = kHardware ? updateHardware(crc, p, length) : updateSoftware(crc, p, length);
+    return ~crc;
+}
+
+uint32_t combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB)
+{
+    return multiplyModP(powerModP(lengthB, 3), crcA) ^ crcB;
+}
+
+bool isHardwareAccelerated()
+{
+    return kHardware;
+}
+
+}
@@ -0,0 +1,21 @@
+//crc32c.h
+//CRC32C（Castagnoli）校验：x86 SSE4.2 / ARMv8 CRC指令硬件加速，运行时检测，不支持时使用查表法
+//CRC值可以拼接：已知A、B两段各自的CRC和B的长度即可算出A+B的CRC，分段下载时各段独立计算后合并
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Crc32c {
+
+// 在已有CRC基础上继续计算，初始值传0
+uint32_t update(uint32_t crc, const void *data, size_t length);
+
+// 返回 crc(A + B)，crcA、crcB分别是A、B的CRC，lengthB是B的字节数
+uint32_t combine(uint32_t crcA, uint32_t crcB, uint64_t lengthB);
+
+// 当前CPU是否使用硬件指令
+bool isHardwareAccelerated();
+
+}
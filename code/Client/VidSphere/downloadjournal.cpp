@@ -0,0 +1,64 @@
+//downloadjournal.cpp
+
+#include "downloadjournal.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+// 从JSON文件读取日志，文件不存在或格式错误时返回false
+bool DownloadJournal::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(file.readAll());
+    if (!jsonDoc.isObject()) return false;
+
+    QJsonObject jsonObj = jsonDoc.object();
+    url = jsonObj["url"].toString();
+    validator = jsonObj["validator"].toString();
+    totalSize = jsonObj["total_size"].toInteger(-1);
+    committed = jsonObj["committed"].toInteger(0);
+    segmented = jsonObj["segmented"].toBool(false);
+
+    pendingRanges.clear();
+    const QJsonArray ranges = jsonObj["pending"].toArray();
+    for (const QJsonValue &value : ranges) {
+        QJsonArray range = value.toArray();
+        qint64 start = range.at(0).toInteger(-1);
+        qint64 end = range.at(1).toInteger(-1);
+        if (start < 0 || end <= start) return false;
+        pendingRanges.append(qMakePair(start, end));
+    }
+    return !url.isEmpty() && committed >= 0;
+}
+
+// 写入日志，QSaveFile保证崩溃时不会留下半个JSON
+bool DownloadJournal::save(const QString &path) const
+{
+    QJsonObject jsonObj;
+    jsonObj["url"] = url;
+    jsonObj["validator"] = validator;
+    jsonObj["total_size"] = totalSize;
+    jsonObj["committed"] = committed;
+    if (segmented) {
+        QJsonArray ranges;
+        for (const auto &range : pendingRanges) {
+            ranges.append(QJsonArray{range.first, range.second});
+        }
+        jsonObj["segmented"] = true;
+        jsonObj["pending"] = ranges;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(jsonObj).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+bool DownloadJournal::remove(const QString &path)
+{
+    return QFile::remove(path);
+}
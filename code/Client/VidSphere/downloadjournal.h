@@ -0,0 +1,27 @@
+//downloadjournal.h
+//断点续传日志：记录 .part 文件对应的URL、服务器校验标识(ETag/Last-Modified)和已落盘字节数
+//分段下载时改为记录尚未完成的字节区间
+
+#pragma once
+
+#include <QList>
+#include <QPair>
+#include <QString>
+
+struct DownloadJournal
+{
+    QString url;        // 下载地址
+    QString validator;  // If-Range使用的校验标识，强ETag优先，否则为Last-Modified
+    qint64 totalSize = -1;
+    qint64 committed = 0;  // 已写入并刷新到 .part 文件的字节数
+    bool segmented = false;                     // 是否为分段下载产生的日志
+    QList<QPair<qint64, qint64>> pendingRanges; // 分段下载：尚未下载的区间 [start, end)
+
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+    static bool remove(const QString &path);
+
+    // 日志与 .part 文件的命名规则
+    static QString partPath(const QString &savePath) { return savePath + ".part"; }
+    static QString journalPath(const QString &savePath) { return savePath + ".part.json"; }
+};
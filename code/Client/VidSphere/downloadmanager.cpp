@@ -0,0 +1,409 @@
+//downloadmanager.cpp
+//下载队列调度：优先级高的先下载，同优先级按加入顺序；每秒统计一次各下载的速度
+
+#include "downloadmanager.h"
+#include "downloadjournal.h"
+#include "segmenteddownload.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <algorithm>
+
+DownloadManager::DownloadManager(QNetworkAccessManager *manager, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_maxConcurrent(kDefaultConcurrent)
+    , m_nextId(1)
+{
+    m_speedTimer.setInterval(1000);
+    connect(&m_speedTimer, &QTimer::timeout, this, &DownloadManager::onSpeedTick);
+
+    // 多次修改合并为一次写盘
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(500);
+    connect(&m_saveTimer, &QTimer::timeout, this, &DownloadManager::writeQueueFile);
+
+    load();
+    // 等事件循环启动后再恢复上次未完成的下载
+    QMetaObject::invokeMethod(this, &DownloadManager::schedule, Qt::QueuedConnection);
+}
+
+DownloadManager::~DownloadManager()
+{
+    // 正在运行的下载记为排队，下次启动时续传
+    for (DownloadItem &item : m_items) {
+        if (item.state == DownloadItem::Running) { item.state = DownloadItem::Queued; }
+    }
+    writeQueueFile();
+    qDeleteAll(m_tasks);
+}
+
+// 加入下载队列
+int DownloadManager::enqueue(const QString &name, const QUrl &url, const QString &savePath, int priority)
+{
+    for (DownloadItem &item : m_items) {
+        if (item.savePath == savePath && item.state != DownloadItem::Completed) {
+            if (item.state == DownloadItem::Paused || item.state == DownloadItem::Failed) { resume(item.id); }
+            return item.id;
+        }
+    }
+
+    DownloadItem item;
+    item.id = m_nextId++;
+    item.name = name;
+    item.url = url;
+    item.savePath = savePath;
+    item.priority = priority;
+    m_items.append(item);
+
+    emit itemAdded(item.id);
+    save();
+    schedule();
+    return item.id;
+}
+
+// 暂停：停止连接，.part 和日志保留
+void DownloadManager::pause(int id)
+{
+    DownloadItem *item = findItem(id);
+    if (!item || !item->isActive()) return;
+
+    item->state = DownloadItem::Paused;
+    item->speed = 0;
+    stopTask(id);
+
+    emit itemChanged(id);
+    emit statsChanged();
+    save();
+    schedule();
+}
+
+// 继续或重试
+void DownloadManager::resume(int id)
+{
+    DownloadItem *item = findItem(id);
+    if (!item || (item->state != DownloadItem::Paused && item->state != DownloadItem::Failed)) return;
+
+    item->state = DownloadItem::Queued;
+    item->errorString.clear();
+
+    emit itemChanged(id);
+    save();
+    schedule();
+}
+
+// 取消：停止下载并删除 .part 文件和日志
+void DownloadManager::cancel(int id)
+{
+    DownloadItem *item = findItem(id);
+    if (!item) return;
+
+    stopTask(id);
+    if (item->state != DownloadItem::Completed) {
+        QFile::remove(DownloadJournal::partPath(item->savePath));
+        DownloadJournal::remove(DownloadJournal::journalPath(item->savePath));
+    }
+    remove(id);
+}
+
+// 从列表中移除
+void DownloadManager::remove(int id)
+{
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (m_items[i].id != id) continue;
+
+        stopTask(id);
+        m_items.removeAt(i);
+        emit itemRemoved(id);
+        emit statsChanged();
+        save();
+        schedule();
+        return;
+    }
+}
+
+// 清除已完成的下载
+void DownloadManager::clearFinished()
+{
+    QList<int> finishedIds;
+    for (const DownloadItem &item : m_items) {
+        if (item.state == DownloadItem::Completed) { finishedIds.append(item.id); }
+    }
+    for (int id : finishedIds) { remove(id); }
+}
+
+void DownloadManager::setPriority(int id, int priority)
+{
+    DownloadItem *item = findItem(id);
+    if (!item || item->priority == priority) return;
+
+    item->priority = priority;
+    emit itemChanged(id);
+    save();
+    schedule();
+}
+
+void DownloadManager::moveToTop(int id)
+{
+    int highest = 0;
+    for (const DownloadItem &item : m_items) { highest = qMax(highest, item.priority); }
+    setPriority(id, highest + 1);
+}
+
+// 修改并发数，超出部分中优先级最低的下载退回队列
+void DownloadManager::setMaxConcurrent(int count)
+{
+    m_maxConcurrent = qMax(1, count);
+
+    while (getRunningCount() > maxRunning()) {
+        DownloadItem *lowest = nullptr;
+        for (DownloadItem &item : m_items) {
+            if (item.state == DownloadItem::Running && (!lowest || item.priority < lowest->priority)) { lowest = &item; }
+        }
+        if (!lowest) break;
+        lowest->state = DownloadItem::Queued;
+        lowest->speed = 0;
+        stopTask(lowest->id);
+        emit itemChanged(lowest->id);
+    }
+
+    emit statsChanged();
+    save();
+    schedule();
+}
+
+const DownloadItem *DownloadManager::getItem(int id) const
+{
+    for (const DownloadItem &item : m_items) {
+        if (item.id == id) return &item;
+    }
+    return nullptr;
+}
+
+DownloadItem *DownloadManager::findItem(int id)
+{
+    for (DownloadItem &item : m_items) {
+        if (item.id == id) return &item;
+    }
+    return nullptr;
+}
+
+// 每个运行中的下载至少占一个连接，同时运行的个数不超过连接数预算
+int DownloadManager::maxRunning() const
+{
+    return qMin(m_maxConcurrent, kConnectionBudget);
+}
+
+int DownloadManager::getRunningCount() const
+{
+    return m_tasks.size();
+}
+
+int DownloadManager::getQueuedCount() const
+{
+    int count = 0;
+    for (const DownloadItem &item : m_items) {
+        if (item.state == DownloadItem::Queued) count++;
+    }
+    return count;
+}
+
+double DownloadManager::getTotalSpeed() const
+{
+    double total = 0;
+    for (const DownloadItem &item : m_items) {
+        if (item.state == DownloadItem::Running) total += item.speed;
+    }
+    return total;
+}
+
+// 选出优先级最高（同优先级先加入者优先）的排队项启动，直到达到并发上限
+void DownloadManager::schedule()
+{
+    while (getRunningCount() < maxRunning()) {
+        DownloadItem *next = nullptr;
+        for (DownloadItem &item : m_items) {
+            if (item.state == DownloadItem::Queued && (!next || item.priority > next->priority)) { next = &item; }
+        }
+        if (!next) break;
+        startItem(*next);
+    }
+
+    // 连接数预算在运行中的下载之间平分，除不尽的部分按优先级从高到低各多分一个
+    if (!m_tasks.isEmpty()) {
+        QList<const DownloadItem *> running;
+        for (const DownloadItem &item : std::as_const(m_items)) {
+            if (m_tasks.contains(item.id)) running.append(&item);
+        }
+        std::stable_sort(running.begin(), running.end(), [](const DownloadItem *a, const DownloadItem *b) {
+            return a->priority > b->priority;
+        });
+        int perTask = kConnectionBudget / running.size();
+        int extra = kConnectionBudget % running.size();
+        for (int i = 0; i < running.size(); ++i) {
+            m_tasks.value(running[i]->id)->setMaxConnections(perTask + (i < extra ? 1 : 0));
+        }
+    }
+
+    if (m_tasks.isEmpty()) {
+        m_speedTimer.stop();
+    } else if (!m_speedTimer.isActive()) {
+        m_speedTimer.start();
+    }
+    emit statsChanged();
+}
+
+// 启动一个下载
+void DownloadManager::startItem(DownloadItem &item)
+{
+    int id = item.id;
+    item.state = DownloadItem::Running;
+    item.speed = 0;
+    item.errorString.clear();
+
+    SegmentedDownload *task = new SegmentedDownload(m_manager, item.url, item.savePath, this);
+    m_tasks.insert(id, task);
+    m_lastBytes.insert(id, item.bytesReceived);
+
+    connect(task, &SegmentedDownload::progressChanged, this, [this, id](qint64 bytesReceived, qint64 bytesTotal) {
+        DownloadItem *item = findItem(id);
+        if (!item) return;
+        item->bytesReceived = bytesReceived;
+        if (bytesTotal > 0) { item->bytesTotal = bytesTotal; }
+        emit itemChanged(id);
+    });
+
+    connect(task, &SegmentedDownload::finished, this, [this, id, task](bool success) {
+        m_tasks.remove(id);
+        m_lastBytes.remove(id);
+        task->deleteLater();
+
+        DownloadItem *item = findItem(id);
+        // 暂停、取消时状态已经改过，不再处理
+        if (!item || item->state != DownloadItem::Running) return;
+
+        item->speed = 0;
+        if (success) {
+            item->state = DownloadItem::Completed;
+            item->bytesReceived = item->bytesTotal > 0 ? item->bytesTotal : item->bytesReceived;
+        } else {
+            item->state = DownloadItem::Failed;
+            item->errorString = task->getErrorString();
+        }
+
+        emit itemChanged(id);
+        emit itemFinished(id, success);
+        save();
+        schedule();
+    });
+
+    emit itemChanged(id);
+    save();
+    task->start();
+}
+
+// 停止正在运行的下载（不改变状态）
+void DownloadManager::stopTask(int id)
+{
+    SegmentedDownload *task = m_tasks.take(id);
+    m_lastBytes.remove(id);
+    if (!task) return;
+
+    task->disconnect(this);
+    task->abort();
+    task->deleteLater();
+}
+
+// 每秒根据字节增量计算速度，做一次平滑
+void DownloadManager::onSpeedTick()
+{
+    for (auto it = m_tasks.cbegin(); it != m_tasks.cend(); ++it) {
+        DownloadItem *item = findItem(it.key());
+        if (!item) continue;
+
+        qint64 delta = item->bytesReceived - m_lastBytes.value(it.key(), item->bytesReceived);
+        m_lastBytes[it.key()] = item->bytesReceived;
+        item->speed = item->speed > 0 ? 0.5 * item->speed + 0.5 * delta : delta;
+        emit itemChanged(it.key());
+    }
+    emit statsChanged();
+    save();
+}
+
+QString DownloadManager::queueFilePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/downloads.json";
+}
+
+// 读取上次保存的队列，运行中的下载恢复为排队
+void DownloadManager::load()
+{
+    QFile file(queueFilePath());
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(file.readAll());
+    if (!jsonDoc.isObject()) return;
+
+    QJsonObject jsonObj = jsonDoc.object();
+    m_maxConcurrent = qMax(1, jsonObj["max_concurrent"].toInt(kDefaultConcurrent));
+
+    const QJsonArray itemsArray = jsonObj["items"].toArray();
+    for (const QJsonValue &value : itemsArray) {
+        QJsonObject itemObj = value.toObject();
+        DownloadItem item;
+        item.id = m_nextId++;
+        item.name = itemObj["name"].toString();
+        item.url = QUrl(itemObj["url"].toString());
+        item.savePath = itemObj["save_path"].toString();
+        item.priority = itemObj["priority"].toInt();
+        item.state = static_cast<DownloadItem::State>(itemObj["state"].toInt(DownloadItem::Queued));
+        item.bytesReceived = itemObj["bytes_received"].toInteger();
+        item.bytesTotal = itemObj["bytes_total"].toInteger(-1);
+        item.errorString = itemObj["error"].toString();
+
+        if (!item.url.isValid() || item.savePath.isEmpty()) continue;
+        if (item.state < DownloadItem::Queued || item.state > DownloadItem::Failed) { item.state = DownloadItem::Queued; }
+        if (item.state == DownloadItem::Running) { item.state = DownloadItem::Queued; }
+        m_items.append(item);
+    }
+}
+
+void DownloadManager::save()
+{
+    m_saveTimer.start();
+}
+
+// 写入队列文件
+void DownloadManager::writeQueueFile()
+{
+    m_saveTimer.stop();
+
+    QJsonArray itemsArray;
+    for (const DownloadItem &item : m_items) {
+        QJsonObject itemObj;
+        itemObj["name"] = item.name;
+        itemObj["url"] = item.url.toString();
+        itemObj["save_path"] = item.savePath;
+        itemObj["priority"] = item.priority;
+        itemObj["state"] = static_cast<int>(item.state);
+        itemObj["bytes_received"] = item.bytesReceived;
+        itemObj["bytes_total"] = item.bytesTotal;
+        itemObj["error"] = item.errorString;
+        itemsArray.append(itemObj);
+    }
+
+    QJsonObject jsonObj;
+    jsonObj["max_concurrent"] = m_maxConcurrent;
+    jsonObj["items"] = itemsArray;
+
+    QDir().mkpath(QFileInfo(queueFilePath()).absolutePath());
+    QSaveFile file(queueFilePath());
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(QJsonDocument(jsonObj).toJson(QJsonDocument::Compact));
+    file.commit();
+}
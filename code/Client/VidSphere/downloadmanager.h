@@ -0,0 +1,103 @@
+//downloadmanager.h
+//下载管理器：持久化的下载队列，限制同时进行的下载数，按优先级调度，统计每个下载的进度和速度
+//队列保存在应用数据目录的 downloads.json 中，客户端重启后未完成的下载自动续传
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QTimer>
+#include <QUrl>
+#include "networklimits.h"
+
+class SegmentedDownload;
+
+// 下载项及其状态
+struct DownloadItem
+{
+    enum State {
+        Queued,     // 等待调度
+        Running,    // 正在下载
+        Paused,     // 用户暂停，.part 保留
+        Completed,  // 已完成
+        Failed      // 出错，可重试
+    };
+
+    int id = 0;
+    QString name;
+    QUrl url;
+    QString savePath;
+    int priority = 0;        // 越大越先下载
+    State state = Queued;
+    qint64 bytesReceived = 0;
+    qint64 bytesTotal = -1;
+    double speed = 0;        // 字节/秒
+    QString errorString;
+
+    bool isActive() const { return state == Queued || state == Running; }
+};
+
+class DownloadManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DownloadManager(QNetworkAccessManager *manager, QObject *parent = nullptr);
+    ~DownloadManager();
+
+    // 加入队列，同一目标文件已在队列中时返回已有的id
+    int enqueue(const QString &name, const QUrl &url, const QString &savePath, int priority = 0);
+
+    void pause(int id);
+    void resume(int id);     // 暂停或失败的下载重新排队
+    void cancel(int id);     // 取消并删除已下载部分
+    void remove(int id);     // 从列表中移除已结束的下载
+    void clearFinished();
+
+    void setPriority(int id, int priority);
+    void moveToTop(int id);  // 优先级设为当前最高值+1
+
+    void setMaxConcurrent(int count);
+    int getMaxConcurrent() const { return m_maxConcurrent; }
+
+    QList<DownloadItem> getItems() const { return m_items; }
+    const DownloadItem *getItem(int id) const;
+    int getRunningCount() const;
+    int getQueuedCount() const;
+    double getTotalSpeed() const;
+
+signals:
+    void itemAdded(int id);
+    void itemChanged(int id);
+    void itemRemoved(int id);
+    void itemFinished(int id, bool success);
+    void statsChanged();  // 运行数、排队数或总速度变化
+
+private slots:
+    void onSpeedTick();
+
+private:
+    DownloadItem *findItem(int id);
+    int maxRunning() const;
+    void schedule();                  // 按优先级补足并发数
+    void startItem(DownloadItem &item);
+    void stopTask(int id);
+    void load();
+    void save();                      // 合并短时间内的多次修改后写盘
+    void writeQueueFile();
+    QString queueFilePath() const;
+
+    static constexpr int kDefaultConcurrent = 2;
+    static constexpr int kConnectionBudget = NetworkLimits::kConnectionsPerHost;  // 所有下载共享的连接数，避免挤占播放带宽
+
+    QNetworkAccessManager *m_manager;
+    QList<DownloadItem> m_items;                  // 按加入顺序排列
+    QHash<int, SegmentedDownload *> m_tasks;      // 正在运行的下载
+    QHash<int, qint64> m_lastBytes;               // 上个统计周期的字节数
+    QTimer m_speedTimer;
+    QTimer m_saveTimer;
+    int m_maxConcurrent;
+    int m_nextId;
+};
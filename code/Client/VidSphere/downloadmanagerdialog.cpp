@@ -0,0 +1,228 @@
+//downloadmanagerdialog.cpp
+//下载列表窗口
+
+#include "downloadmanagerdialog.h"
+#include "downloadmanager.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QProgressBar>
+#include <QDesktopServices>
+#include <QFileInfo>
+#include <QUrl>
+
+// 表格列
+enum DownloadColumn {
+    NameColumn = 0,
+    StateColumn,
+    ProgressColumn,
+    SpeedColumn,
+    PriorityColumn,
+    ColumnCount
+};
+
+// 初始化下载列表窗口
+DownloadManagerDialog::DownloadManagerDialog(DownloadManager *manager, QWidget *parent)
+    : QDialog(parent)
+    , m_manager(manager)
+{
+    setWindowTitle("下载列表");
+    resize(760, 420);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    // 下载表格
+    m_table = new QTableWidget(0, ColumnCount, this);
+    m_table->setHorizontalHeaderLabels({"名称", "状态", "进度", "速度", "优先级"});
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->verticalHeader()->setVisible(false);
+    m_table->horizontalHeader()->setSectionResizeMode(NameColumn, QHeaderView::Stretch);
+    m_table->horizontalHeader()->setSectionResizeMode(ProgressColumn, QHeaderView::Fixed);
+    m_table->setColumnWidth(ProgressColumn, 180);
+    mainLayout->addWidget(m_table);
+
+    // 操作按钮
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    m_pauseButton = new QPushButton("暂停", this);
+    m_resumeButton = new QPushButton("继续", this);
+    m_cancelButton = new QPushButton("取消", this);
+    m_topButton = new QPushButton("置顶", this);
+    m_raiseButton = new QPushButton("提高优先级", this);
+    m_lowerButton = new QPushButton("降低优先级", this);
+    m_openFolderButton = new QPushButton("打开文件夹", this);
+    QPushButton *clearButton = new QPushButton("清除已完成", this);
+    buttonLayout->addWidget(m_pauseButton);
+    buttonLayout->addWidget(m_resumeButton);
+    buttonLayout->addWidget(m_cancelButton);
+    buttonLayout->addWidget(m_topButton);
+    buttonLayout->addWidget(m_raiseButton);
+    buttonLayout->addWidget(m_lowerButton);
+    buttonLayout->addWidget(m_openFolderButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(clearButton);
+    mainLayout->addLayout(buttonLayout);
+
+    // 并发数和汇总信息
+    QHBoxLayout *bottomLayout = new QHBoxLayout();
+    bottomLayout->addWidget(new QLabel("同时下载数:", this));
+    m_concurrentSpinBox = new QSpinBox(this);
+    m_concurrentSpinBox->setRange(1, 6);
+    m_concurrentSpinBox->setValue(m_manager->getMaxConcurrent());
+    bottomLayout->addWidget(m_concurrentSpinBox);
+    bottomLayout->addStretch();
+    m_summaryLabel = new QLabel(this);
+    bottomLayout->addWidget(m_summaryLabel);
+    mainLayout->addLayout(bottomLayout);
+
+    // 按钮信号
+    connect(m_pauseButton, &QPushButton::clicked, this, [this]() { m_manager->pause(selectedId()); });
+    connect(m_resumeButton, &QPushButton::clicked, this, [this]() { m_manager->resume(selectedId()); });
+    connect(m_cancelButton, &QPushButton::clicked, this, [this]() { m_manager->cancel(selectedId()); });
+    connect(m_topButton, &QPushButton::clicked, this, [this]() { m_manager->moveToTop(selectedId()); });
+    connect(m_raiseButton, &QPushButton::clicked, this, [this]() {
+        const DownloadItem *item = m_manager->getItem(selectedId());
+        if (item) { m_manager->setPriority(item->id, item->priority + 1); }
+    });
+    connect(m_lowerButton, &QPushButton::clicked, this, [this]() {
+        const DownloadItem *item = m_manager->getItem(selectedId());
+        if (item) { m_manager->setPriority(item->id, item->priority - 1); }
+    });
+    connect(m_openFolderButton, &QPushButton::clicked, this, [this]() {
+        const DownloadItem *item = m_manager->getItem(selectedId());
+        if (item) { QDesktopServices::openUrl(QUrl::fromLocalFile(QFileInfo(item->savePath).absolutePath())); }
+    });
+    connect(clearButton, &QPushButton::clicked, m_manager, &DownloadManager::clearFinished);
+    connect(m_concurrentSpinBox, &QSpinBox::valueChanged, m_manager, &DownloadManager::setMaxConcurrent);
+    connect(m_table, &QTableWidget::itemSelectionChanged, this, &DownloadManagerDialog::onSelectionChanged);
+
+    // 下载管理器信号
+    connect(m_manager, &DownloadManager::itemAdded, this, &DownloadManagerDialog::onItemAdded);
+    connect(m_manager, &DownloadManager::itemChanged, this, &DownloadManagerDialog::onItemChanged);
+    connect(m_manager, &DownloadManager::itemRemoved, this, &DownloadManagerDialog::onItemRemoved);
+    connect(m_manager, &DownloadManager::statsChanged, this, &DownloadManagerDialog::onStatsChanged);
+
+    // 填充现有的下载
+    const QList<DownloadItem> items = m_manager->getItems();
+    for (const DownloadItem &item : items) { onItemAdded(item.id); }
+    onStatsChanged();
+    onSelectionChanged();
+}
+
+// 格式化速度
+QString DownloadManagerDialog::formatSpeed(double bytesPerSecond)
+{
+    if (bytesPerSecond >= 1024 * 1024) return QString("%1 MB/s").arg(bytesPerSecond / (1024 * 1024), 0, 'f', 1);
+    if (bytesPerSecond >= 1024) return QString("%1 KB/s").arg(bytesPerSecond / 1024, 0, 'f', 0);
+    return QString("%1 B/s").arg(static_cast<qint64>(bytesPerSecond));
+}
+
+// 格式化文件大小
+QString DownloadManagerDialog::formatSize(qint64 bytes)
+{
+    if (bytes >= 1024LL * 1024 * 1024) return QString("%1 GB").arg(bytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
+    if (bytes >= 1024 * 1024) return QString("%1 MB").arg(bytes / (1024.0 * 1024), 0, 'f', 1);
+    return QString("%1 KB").arg(bytes / 1024);
+}
+
+// 新增一行
+void DownloadManagerDialog::onItemAdded(int id)
+{
+    int row = m_table->rowCount();
+    m_table->insertRow(row);
+
+    QTableWidgetItem *nameItem = new QTableWidgetItem();
+    nameItem->setData(Qt::UserRole, id);
+    m_table->setItem(row, NameColumn, nameItem);
+    m_table->setItem(row, StateColumn, new QTableWidgetItem());
+    m_table->setItem(row, SpeedColumn, new QTableWidgetItem());
+    m_table->setItem(row, PriorityColumn, new QTableWidgetItem());
+
+    QProgressBar *progressBar = new QProgressBar(m_table);
+    progressBar->setRange(0, 100);
+    m_table->setCellWidget(row, ProgressColumn, progressBar);
+
+    updateRow(row, id);
+}
+
+void DownloadManagerDialog::onItemChanged(int id)
+{
+    int row = rowForId(id);
+    if (row >= 0) { updateRow(row, id); }
+    if (row == m_table->currentRow()) { onSelectionChanged(); }
+}
+
+void DownloadManagerDialog::onItemRemoved(int id)
+{
+    int row = rowForId(id);
+    if (row >= 0) { m_table->removeRow(row); }
+}
+
+// 汇总：正在下载数、排队数、总速度
+void DownloadManagerDialog::onStatsChanged()
+{
+    m_summaryLabel->setText(QString("下载中 %1 个，排队 %2 个，总速度 %3")
+                                .arg(m_manager->getRunningCount())
+                                .arg(m_manager->getQueuedCount())
+                                .arg(formatSpeed(m_manager->getTotalSpeed())));
+}
+
+// 根据选中项的状态启用按钮
+void DownloadManagerDialog::onSelectionChanged()
+{
+    const DownloadItem *item = m_manager->getItem(selectedId());
+    bool hasItem = item != nullptr;
+    m_pauseButton->setEnabled(hasItem && item->isActive());
+    m_resumeButton->setEnabled(hasItem && (item->state == DownloadItem::Paused || item->state == DownloadItem::Failed));
+    m_cancelButton->setEnabled(hasItem);
+    m_topButton->setEnabled(hasItem && item->state != DownloadItem::Completed);
+    m_raiseButton->setEnabled(hasItem && item->state != DownloadItem::Completed);
+    m_lowerButton->setEnabled(hasItem && item->state != DownloadItem::Completed);
+    m_openFolderButton->setEnabled(hasItem);
+}
+
+int DownloadManagerDialog::rowForId(int id) const
+{
+    for (int row = 0; row < m_table->rowCount(); ++row) {
+        if (m_table->item(row, NameColumn)->data(Qt::UserRole).toInt() == id) return row;
+    }
+    return -1;
+}
+
+int DownloadManagerDialog::selectedId() const
+{
+    int row = m_table->currentRow();
+    if (row < 0 || !m_table->item(row, NameColumn)) return -1;
+    return m_table->item(row, NameColumn)->data(Qt::UserRole).toInt();
+}
+
+// 刷新一行的显示
+void DownloadManagerDialog::updateRow(int row, int id)
+{
+    const DownloadItem *item = m_manager->getItem(id);
+    if (!item) return;
+
+    static const QStringList stateNames = {"排队中", "下载中", "已暂停", "已完成", "失败"};
+
+    m_table->item(row, NameColumn)->setText(item->name);
+    m_table->item(row, NameColumn)->setToolTip(item->savePath);
+
+    QString stateText = stateNames.value(item->state);
+    if (item->state == DownloadItem::Failed && !item->errorString.isEmpty()) {
+        m_table->item(row, StateColumn)->setToolTip(item->errorString);
+    }
+    m_table->item(row, StateColumn)->setText(stateText);
+
+    QProgressBar *progressBar = qobject_cast<QProgressBar *>(m_table->cellWidget(row, ProgressColumn));
+    if (progressBar) {
+        int progress = item->bytesTotal > 0 ? static_cast<int>(item->bytesReceived * 100 / item->bytesTotal) : 0;
+        progressBar->setValue(progress);
+        progressBar->setFormat(item->bytesTotal > 0
+                                   ? QString("%1 / %2").arg(formatSize(item->bytesReceived), formatSize(item->bytesTotal))
+                                   : QString("%p%"));
+    }
+
+    m_table->item(row, SpeedColumn)->setText(item->state == DownloadItem::Running ? formatSpeed(item->speed) : QString());
+    m_table->item(row, PriorityColumn)->setText(QString::number(item->priority));
+}
@@ -0,0 +1,47 @@
+//downloadmanagerdialog.h
+//下载列表窗口：显示每个下载的状态、进度、速度和优先级，提供暂停/继续/取消/调整优先级和并发数
+
+#pragma once
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QSpinBox>
+#include <QPushButton>
+#include <QLabel>
+
+class DownloadManager;
+
+class DownloadManagerDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DownloadManagerDialog(DownloadManager *manager, QWidget *parent = nullptr);
+
+    static QString formatSpeed(double bytesPerSecond);
+    static QString formatSize(qint64 bytes);
+
+private slots:
+    void onItemAdded(int id);
+    void onItemChanged(int id);
+    void onItemRemoved(int id);
+    void onStatsChanged();
+    void onSelectionChanged();
+
+private:
+    int rowForId(int id) const;
+    int selectedId() const;
+    void updateRow(int row, int id);
+
+    DownloadManager *m_manager;
+    QTableWidget *m_table;
+    QSpinBox *m_concurrentSpinBox;
+    QPushButton *m_pauseButton;
+    QPushButton *m_resumeButton;
+    QPushButton *m_cancelButton;
+    QPushButton *m_topButton;
+    QPushButton *m_raiseButton;
+    QPushButton *m_lowerButton;
+    QPushButton *m_openFolderButton;
+    QLabel *m_summaryLabel;
+};
@@ -0,0 +1,327 @@
+//downloadtask.cpp
+//下载任务：readyRead时分块落盘，setReadBufferSize限制reply内部缓冲实现背压
+//断点续传：Range: bytes=N- 加 If-Range，服务器文件变化时返回200，此时丢弃 .part 从头下载
+
+#include "downloadtask.h"
+#include <QFileInfo>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+
+DownloadTask::DownloadTask(QNetworkAccessManager *manager,
+                           const QUrl &url,
+                           const QString &savePath,
+                           QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_reply(nullptr)
+    , m_file(DownloadJournal::partPath(savePath))
+    , m_url(url)
+    , m_savePath(savePath)
+    , m_bytesWritten(0)
+    , m_bytesTotal(-1)
+    , m_resumeOffset(0)
+    , m_lastCommitted(0)
+    , m_headersChecked(false)
+    , m_restarted(false)
+    , m_done(false)
+{
+    m_chunk.resize(kChunkSize);
+    connect(&m_verifier, &DownloadVerifier::verified, this, &DownloadTask::onVerified);
+}
+
+DownloadTask::~DownloadTask()
+{
+    if (m_reply) {
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+    }
+    if (m_file.isOpen()) {
+        commitJournal();
+        m_file.close();
+    }
+}
+
+// 打开 .part 文件，存在匹配的日志时从已落盘位置续传
+bool DownloadTask::start()
+{
+    const QString journalPath = DownloadJournal::journalPath(m_savePath);
+
+    DownloadJournal saved;
+    bool resumable = saved.load(journalPath)
+                     && !saved.segmented
+                     && saved.url == m_url.toString()
+                     && !saved.validator.isEmpty()
+                     && QFileInfo(m_file.fileName()).size() >= saved.committed;
+
+    if (!m_file.open(resumable ? QIODevice::ReadWrite : (QIODevice::WriteOnly | QIODevice::Truncate))) {
+        m_errorString = "无法创建文件: " + m_file.errorString();
+        return false;
+    }
+
+    if (resumable) {
+        // 日志之后写入的数据可能不完整，截断到最后一次提交的位置
+        m_journal = saved;
+        m_file.resize(m_journal.committed);
+        m_file.seek(m_journal.committed);
+        m_bytesWritten = m_journal.committed;
+        m_bytesTotal = m_journal.totalSize;
+    } else {
+        m_journal = DownloadJournal();
+        m_journal.url = m_url.toString();
+    }
+    m_lastCommitted = m_bytesWritten;
+
+    // 上次已经全部下载完，只差重命名
+    if (resumable && m_journal.totalSize > 0 && m_journal.committed == m_journal.totalSize) {
+        m_done = true;
+        if (!finalize()) {
+            m_done = false;
+            m_errorString = "无法保存文件: " + m_file.errorString();
+            return false;
+        }
+        // 延迟到事件循环中发出，调用方此时还没来得及连接信号
+        QMetaObject::invokeMethod(this, [this]() {
+            emit progressChanged(m_bytesWritten, m_bytesWritten);
+            emit finished(true);
+        }, Qt::QueuedConnection);
+        return true;
+    }
+
+    sendRequest();
+    return true;
+}
+
+// 发出GET请求，有已下载数据时附带Range和If-Range
+void DownloadTask::sendRequest()
+{
+    QNetworkRequest request(m_url);
+    m_resumeOffset = m_bytesWritten;
+    m_headersChecked = false;
+
+    if (m_resumeOffset > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(m_resumeOffset) + "-");
+        // 文件已变化时服务器忽略Range返回200，避免把新旧内容拼在一起
+        request.setRawHeader("If-Range", m_journal.validator.toUtf8());
+    }
+
+    m_reply = m_manager->get(request);
+
+    // 限制reply内部缓冲区大小：缓冲区满时Qt停止从socket读取，由TCP窗口向服务器施加背压
+    m_reply->setReadBufferSize(kReadBufferSize);
+
+    connect(m_reply, &QNetworkReply::metaDataChanged, this, &DownloadTask::onMetaDataChanged);
+    connect(m_reply, &QNetworkReply::readyRead, this, &DownloadTask::onReadyRead);
+    connect(m_reply, &QNetworkReply::finished, this, &DownloadTask::onReplyFinished);
+}
+
+// 取消下载，finished信号会以失败结束，.part 和日志保留
+void DownloadTask::abort()
+{
+    if (m_reply && !m_done) { m_reply->abort(); }
+}
+
+// 收到响应头：判断服务器是否接受了续传，并记录校验标识
+void DownloadTask::onMetaDataChanged()
+{
+    if (m_headersChecked || m_done) return;
+
+    int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status != 200 && status != 206) return; // 错误状态交给finished处理
+    m_headersChecked = true;
+
+    if (status == 206) {
+        // Content-Range: bytes start-end/total
+        static const QRegularExpression rangeRe("bytes\\s+(\\d+)-(\\d+)/(\\d+|\\*)");
+        QRegularExpressionMatch match = rangeRe.match(QString::fromLatin1(m_reply->rawHeader("Content-Range")));
+        if (!match.hasMatch() || match.captured(1).toLongLong() != m_resumeOffset) {
+            fail("服务器返回的续传范围不正确");
+            return;
+        }
+        if (match.captured(3) != "*") { m_bytesTotal = match.captured(3).toLongLong(); }
+    } else {
+        // 服务器忽略了Range（不支持或文件已变化），从头写入
+        if (m_bytesWritten > 0) {
+            m_file.resize(0);
+            m_file.seek(0);
+            m_bytesWritten = 0;
+            m_lastCommitted = 0;
+        }
+        m_verifier.reset();
+        m_resumeOffset = 0;
+        m_bytesTotal = m_reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+        if (m_bytesTotal <= 0) { m_bytesTotal = -1; }
+    }
+
+    // 弱ETag不能用于If-Range，退而使用Last-Modified
+    QString etag = QString::fromLatin1(m_reply->rawHeader("ETag"));
+    if (!etag.isEmpty() && !etag.startsWith("W/")) {
+        m_journal.validator = etag;
+    } else {
+        m_journal.validator = QString::fromLatin1(m_reply->rawHeader("Last-Modified"));
+    }
+    m_journal.totalSize = m_bytesTotal;
+    commitJournal();
+
+    // 服务器提供了整个文件的CRC32C时边下载边校验
+    quint32 digest = 0;
+    if (DownloadVerifier::parseDigest(m_reply->rawHeader("X-Checksum-CRC32C"), &digest)) { m_verifier.setExpected(digest); }
+}
+
+// 处理新到达的数据
+void DownloadTask::onReadyRead()
+{
+    if (m_done || !m_headersChecked) return;
+
+    if (!drainReply()) {
+        fail("写入文件失败: " + m_file.errorString());
+        return;
+    }
+    if (m_bytesWritten - m_lastCommitted >= kJournalInterval) { commitJournal(); }
+    emit progressChanged(m_bytesWritten, m_bytesTotal);
+}
+
+// 分块读取reply缓冲区并写入文件，缓冲区始终不超过kChunkSize
+bool DownloadTask::drainReply()
+{
+    while (m_reply->bytesAvailable() > 0) {
+        qint64 n = m_reply->read(m_chunk.data(), kChunkSize);
+        if (n <= 0) break;
+        if (m_file.write(m_chunk.constData(), n) != n) { return false; }
+        m_verifier.addData(m_bytesWritten, m_chunk.constData(), n);
+        m_bytesWritten += n;
+    }
+    return true;
+}
+
+// 先刷新文件再写日志，保证日志记录的字节一定已经交给操作系统
+bool DownloadTask::commitJournal()
+{
+    if (m_journal.validator.isEmpty()) return false; // 没有校验标识无法安全续传
+    if (!m_file.flush()) return false;
+
+    m_journal.committed = m_bytesWritten;
+    m_lastCommitted = m_bytesWritten;
+    return m_journal.save(DownloadJournal::journalPath(m_savePath));
+}
+
+// 处理请求结束
+void DownloadTask::onReplyFinished()
+{
+    if (m_done) return;
+
+    int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    // 416：日志记录的偏移已超出服务器文件长度，丢弃后从头下载一次
+    if (status == 416 && !m_restarted) {
+        m_restarted = true;
+        m_reply->disconnect(this);
+        m_reply->deleteLater();
+        m_reply = nullptr;
+        discardPartial();
+        sendRequest();
+        return;
+    }
+
+    if (m_reply->error() != QNetworkReply::NoError) {
+        fail(m_reply->errorString());
+        return;
+    }
+
+    // 读取最后一批数据
+    if (!m_headersChecked) { onMetaDataChanged(); }
+    if (m_done) return;
+    if (!drainReply() || !m_file.flush()) {
+        fail("写入文件失败: " + m_file.errorString());
+        return;
+    }
+
+    m_done = true;
+    m_reply->deleteLater();
+    m_reply = nullptr;
+
+    // 等后台校验完成后再重命名，续传前下载的部分由校验器补读
+    if (m_verifier.hasExpected()) {
+        m_file.close();
+        m_verifier.finish(m_file.fileName(), m_bytesWritten);
+        return;
+    }
+    complete();
+}
+
+// 校验结果：不一致时文件已损坏，续传也无法修复，删除后报告失败
+void DownloadTask::onVerified(bool success)
+{
+    if (success) {
+        complete();
+        return;
+    }
+
+    m_file.remove();
+    DownloadJournal::remove(DownloadJournal::journalPath(m_savePath));
+    m_errorString = QString("文件校验失败（CRC32C %1），请重新下载").arg(m_verifier.getResult(), 8, 16, QChar('0'));
+    emit finished(false);
+}
+
+void DownloadTask::complete()
+{
+    if (!finalize()) {
+        m_done = false;
+        fail("无法保存文件: " + m_file.errorString());
+        return;
+    }
+
+    emit progressChanged(m_bytesWritten, m_bytesWritten);
+    emit finished(true);
+}
+
+// 下载完成：替换目标文件并删除日志
+bool DownloadTask::finalize()
+{
+    m_file.close();
+    if (QFile::exists(m_savePath)) { QFile::remove(m_savePath); }
+    if (!m_file.rename(m_savePath)) return false;
+    DownloadJournal::remove(DownloadJournal::journalPath(m_savePath));
+    return true;
+}
+
+// 丢弃已下载部分
+void DownloadTask::discardPartial()
+{
+    m_file.resize(0);
+    m_file.seek(0);
+    m_bytesWritten = 0;
+    m_lastCommitted = 0;
+    m_journal = DownloadJournal();
+    m_journal.url = m_url.toString();
+    m_verifier.reset();
+    DownloadJournal::remove(DownloadJournal::journalPath(m_savePath));
+}
+
+// 失败时保留 .part 和日志，下次下载同一目标时续传
+void DownloadTask::fail(const QString &message)
+{
+    if (m_done) return;
+    m_done = true;
+    m_errorString = message;
+
+    if (m_reply) {
+        // 取出reply中已到达但尚未写入的数据
+        if (m_headersChecked) { drainReply(); }
+        m_reply->disconnect(this);
+        m_reply->abort();
+        m_reply->deleteLater();
+        m_reply = nullptr;
+    }
+    if (m_file.isOpen()) {
+        if (!commitJournal()) {
+            // 无法续传的数据没有保留价值
+            m_file.close();
+            m_file.remove();
+        } else {
+            m_file.close();
+        }
+    }
+
+    emit finished(false);
+}
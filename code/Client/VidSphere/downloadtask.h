@@ -0,0 +1,75 @@
+//downloadtask.h
+//单个视频下载任务：边接收边按固定大小分块写入磁盘，内存占用与文件大小无关
+//数据先写入 <目标>.part，并用日志记录进度，中断后（包括客户端重启）通过HTTP Range断点续传
+
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QUrl>
+#include "downloadjournal.h"
+#include "downloadverifier.h"
+
+class DownloadTask : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DownloadTask(QNetworkAccessManager *manager,
+                          const QUrl &url,
+                          const QString &savePath,
+                          QObject *parent = nullptr);
+    ~DownloadTask();
+
+    bool start();  // 打开 .part 文件并发出GET请求（有日志时带Range续传），失败时返回false
+    void abort();  // 取消下载，已下载部分保留以便续传
+
+    QUrl getUrl() const { return m_url; }
+    QString getSavePath() const { return m_savePath; }
+    QString getErrorString() const { return m_errorString; }
+    qint64 getBytesWritten() const { return m_bytesWritten; }
+    qint64 getResumeOffset() const { return m_resumeOffset; }
+
+signals:
+    void progressChanged(qint64 bytesReceived, qint64 bytesTotal);
+    void finished(bool success);
+
+private slots:
+    void onMetaDataChanged();
+    void onReadyRead();
+    void onReplyFinished();
+    void onVerified(bool success);
+
+private:
+    void sendRequest();
+    bool drainReply();                   // 把reply缓冲区中的数据分块写入文件
+    bool commitJournal();                // 刷新 .part 并更新日志中的已落盘字节数
+    void complete();                     // 重命名并报告成功
+    bool finalize();                     // .part 重命名为目标文件并删除日志
+    void discardPartial();               // 删除 .part 和日志，从头开始
+    void fail(const QString &message);
+
+    static constexpr qint64 kChunkSize = 256 * 1024;            // 每次从reply读取的块大小
+    static constexpr qint64 kReadBufferSize = 4 * 1024 * 1024;  // reply读缓冲上限，写满后暂停从socket读取
+    static constexpr qint64 kJournalInterval = 8 * 1024 * 1024; // 每写入这么多字节更新一次日志
+
+    QNetworkAccessManager *m_manager;
+    QNetworkReply *m_reply;
+    QFile m_file;
+    QByteArray m_chunk;  // 复用的块缓冲区
+    QUrl m_url;
+    QString m_savePath;
+    QString m_errorString;
+    DownloadJournal m_journal;
+    DownloadVerifier m_verifier;
+    qint64 m_bytesWritten;     // .part 文件当前长度
+    qint64 m_bytesTotal;
+    qint64 m_resumeOffset;     // 本次请求的起始偏移
+    qint64 m_lastCommitted;
+    bool m_headersChecked;
+    bool m_restarted;          // 416后已从头重试过一次
+    bool m_done;
+};
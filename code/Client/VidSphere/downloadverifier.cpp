@@ -0,0 +1,180 @@
+//downloadverifier.cpp
+//数据块复制一份交给私有线程池计算，结果回到所属线程合并；硬件CRC32C比网络快得多，一个线程足够
+
+#include "downloadverifier.h"
+#include "crc32c.h"
+#include <QFile>
+
+DownloadVerifier::DownloadVerifier(QObject *parent)
+    : QObject(parent)
+    , m_cancelled(false)
+    , m_pendingBytes(0)
+    , m_pendingBlocks(0)
+    , m_generation(0)
+    , m_totalSize(0)
+    , m_expected(0)
+    , m_result(0)
+    , m_hasExpected(false)
+    , m_finishing(false)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+DownloadVerifier::~DownloadVerifier()
+{
+    m_cancelled = true;
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+bool DownloadVerifier::parseDigest(const QByteArray &value, quint32 *crc)
+{
+    QByteArray hex = value.trimmed();
+    if (hex.isEmpty() || hex.size() > 8) return false;
+    bool ok = false;
+    quint32 parsed = hex.toUInt(&ok, 16);
+    if (ok) { *crc = parsed; }
+    return ok;
+}
+
+void DownloadVerifier::setExpected(quint32 crc)
+{
+    m_expected = crc;
+    m_hasExpected = true;
+}
+
+// 接在同一连接上一块数据之后的追加到缓冲区，否则新开一个缓冲区
+void DownloadVerifier::addData(qint64 offset, const char *data, qint64 length)
+{
+    if (!m_hasExpected || m_finishing || length <= 0) return;
+
+    Buffer buffer = m_buffers.take(offset);
+    if (buffer.data.isEmpty()) {
+        buffer.start = offset;
+        buffer.data.reserve(kBlockSize);
+    }
+    buffer.data.append(data, length);
+
+    if (buffer.data.size() >= kBlockSize) {
+        submit(buffer.start, buffer.data);
+        buffer.start += buffer.data.size();
+        buffer.data.clear();
+    }
+    if (!buffer.data.isEmpty()) { m_buffers.insert(buffer.start + buffer.data.size(), buffer); }
+}
+
+// 重新下载时清空，仍在计算的块回来后按generation丢弃
+void DownloadVerifier::reset()
+{
+    m_generation++;
+    m_buffers.clear();
+    m_runs.clear();
+    m_hasExpected = false;
+    m_finishing = false;
+}
+
+void DownloadVerifier::submit(qint64 start, const QByteArray &data)
+{
+    // 后台跟不上时不再排队，这部分在结束时从文件补读
+    if (m_pendingBytes + data.size() > kMaxPendingBytes) return;
+
+    m_pendingBytes += data.size();
+    m_pendingBlocks++;
+    int generation = m_generation;
+    m_pool.start([this, generation, start, data]() {
+        quint32 crc = Crc32c::update(0, data.constData(), data.size());
+        QMetaObject::invokeMethod(this, [this, generation, start, length = qint64(data.size()), crc]() {
+            onBlockHashed(generation, start, length, crc);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DownloadVerifier::onBlockHashed(int generation, qint64 start, qint64 length, quint32 crc)
+{
+    m_pendingBytes -= length;
+    m_pendingBlocks--;
+    if (generation == m_generation) { mergeRun(start, start + length, crc); }
+    checkFinished();
+}
+
+// 插入 [start, end)，并与前后相邻的段合并
+void DownloadVerifier::mergeRun(qint64 start, qint64 end, quint32 crc)
+{
+    auto next = m_runs.find(end);
+    if (next != m_runs.end()) {
+        crc = Crc32c::combine(crc, next->crc, next->end - end);
+        end = next->end;
+        m_runs.erase(next);
+    }
+
+    auto it = m_runs.lowerBound(start);
+    if (it != m_runs.begin()) {
+        auto prev = std::prev(it);
+        if (prev->end == start) {
+            prev->crc = Crc32c::combine(prev->crc, crc, end - start);
+            prev->end = end;
+            return;
+        }
+    }
+    m_runs.insert(start, Run{end, crc});
+}
+
+void DownloadVerifier::finish(const QString &filePath, qint64 totalSize)
+{
+    m_filePath = filePath;
+    m_totalSize = totalSize;
+    m_finishing = true;
+
+    for (const Buffer &buffer : std::as_const(m_buffers)) { submit(buffer.start, buffer.data); }
+    m_buffers.clear();
+    checkFinished();
+}
+
+// 所有块都算完后，在后台线程按顺序拼接各段并补读空缺
+void DownloadVerifier::checkFinished()
+{
+    if (!m_finishing || m_pendingBlocks > 0) return;
+    m_finishing = false;
+
+    QMap<qint64, Run> runs = m_runs;
+    QString filePath = m_filePath;
+    qint64 totalSize = m_totalSize;
+    int generation = m_generation;
+
+    m_pool.start([this, runs, filePath, totalSize, generation]() {
+        QFile file(filePath);
+        bool ok = file.open(QIODevice::ReadOnly);
+        QByteArray block(ok ? kBlockSize : 0, Qt::Uninitialized);
+        quint32 crc = 0;
+        qint64 offset = 0;
+
+        auto run = runs.cbegin();
+        while (ok && offset < totalSize && !m_cancelled) {
+            while (run != runs.cend() && run.key() < offset) { ++run; }
+            if (run != runs.cend() && run.key() == offset) {
+                qint64 end = qMin(run->end, totalSize);
+                crc = Crc32c::combine(crc, run->crc, end - offset);
+                offset = end;
+                ++run;
+                continue;
+            }
+
+            // 空缺区间：读到下一段的起点为止
+            qint64 gapEnd = run != runs.cend() ? qMin(run.key(), totalSize) : totalSize;
+            qint64 want = qMin<qint64>(kBlockSize, gapEnd - offset);
+            if (!file.seek(offset) || file.read(block.data(), want) != want) {
+                ok = false;
+                break;
+            }
+            crc = Crc32c::update(crc, block.constData(), want);
+            offset += want;
+        }
+        if (m_cancelled) return;
+
+        QMetaObject::invokeMethod(this, [this, ok, crc, generation]() {
+            if (generation != m_generation) return;
+            m_result = crc;
+            emit verified(ok && crc == m_expected);
+        }, Qt::QueuedConnection);
+    });
+}
@@ -0,0 +1,75 @@
+//downloadverifier.h
+//下载完整性校验：数据写入文件的同时在后台线程计算CRC32C，下载结束后与服务器给出的 X-Checksum-CRC32C 比较
+//各段数据按文件偏移记录，相邻的段用CRC拼接合并，乱序到达的分段下载也无需重新读取文件
+//续传前已下载的部分本次没有经过校验器，结束时只重新读取这些空缺区间
+
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QThreadPool>
+#include <atomic>
+
+class DownloadVerifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DownloadVerifier(QObject *parent = nullptr);
+    ~DownloadVerifier();
+
+    // 解析响应头中的CRC32C（8位十六进制）
+    static bool parseDigest(const QByteArray &value, quint32 *crc);
+
+    void setExpected(quint32 crc);
+    bool hasExpected() const { return m_hasExpected; }
+
+    void addData(qint64 offset, const char *data, qint64 length);  // 已写入文件 offset 处的数据
+    void reset();                                                  // 丢弃所有结果（文件从头重新下载）
+
+    // 等待后台计算完成，补读空缺区间后发出verified
+    void finish(const QString &filePath, qint64 totalSize);
+    quint32 getResult() const { return m_result; }
+
+signals:
+    void verified(bool success);
+
+private:
+    // 一段连续数据的CRC
+    struct Run
+    {
+        qint64 end = 0;
+        quint32 crc = 0;
+    };
+
+    // 尚未提交计算的连续数据
+    struct Buffer
+    {
+        qint64 start = 0;
+        QByteArray data;
+    };
+
+    void submit(qint64 start, const QByteArray &data);
+    void onBlockHashed(int generation, qint64 start, qint64 length, quint32 crc);
+    void mergeRun(qint64 start, qint64 end, quint32 crc);
+    void checkFinished();
+
+    static constexpr qint64 kBlockSize = 1024 * 1024;               // 攒够这么多再交给后台线程
+    static constexpr qint64 kMaxPendingBytes = 64 * 1024 * 1024;    // 后台积压上限，超出的数据留到最后补读
+
+    QThreadPool m_pool;
+    QHash<qint64, Buffer> m_buffers;  // 以缓冲区末尾偏移为键，便于接上同一连接的后续数据
+    QMap<qint64, Run> m_runs;         // 以起始偏移为键，互不重叠且相邻的已合并
+    std::atomic<bool> m_cancelled;
+    qint64 m_pendingBytes;
+    int m_pendingBlocks;
+    int m_generation;                 // reset后递增，丢弃旧的计算结果
+    QString m_filePath;
+    qint64 m_totalSize;
+    quint32 m_expected;
+    quint32 m_result;
+    bool m_hasExpected;
+    bool m_finishing;
+};
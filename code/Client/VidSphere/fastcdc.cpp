@@ -0,0 +1,139 @@
+//fastcdc.cpp
+//Gear哈希每个字节左移一位再加上随机表值，高位由最近64个字节决定，掩码取高位
+//参考 Xia et al., "FastCDC: a Fast and Efficient Content-Defined Chunking Approach" (USENIX ATC 2016)
+
+#include "fastcdc.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <array>
+
+namespace {
+
+// 用splitmix64生成固定的Gear表，客户端各版本之间必须一致，否则切点变化导致去重失效
+constexpr std::array<quint64, 256> makeGearTable()
+{
+    std::array<quint64, 256> table{};
+    quint64 state = 0x5643445356494453ULL;
+    for (quint64 &value : table) {
+        state += 0x9E3779B97F4A7C15ULL;
+        quint64 z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        value = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr auto kGear = makeGearTable();
+
+// 平均块大小为2^20，到达平均大小前多要求2位为0，之后少要求2位
+constexpr quint64 kMaskStrict = ~0ULL << (64 - 22);
+constexpr quint64 kMaskLoose = ~0ULL << (64 - 18);
+
+constexpr qint64 kReadSize = 8 * 1024 * 1024;
+
+CdcChunk makeChunk(qint64 offset, QByteArrayView data)
+{
+    CdcChunk chunk;
+    chunk.offset = offset;
+    chunk.length = data.size();
+    chunk.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+    return chunk;
+}
+
+}
+
+qint64 FastCdc::cutPoint(const uchar *data, qint64 length)
+{
+    if (length <= kMinSize) return length;
+
+    qint64 end = qMin(length, kMaxSize);
+    qint64 normal = qMin(end, kAvgSize);
+    quint64 fingerprint = 0;
+
+    // 最小块大小以内不可能切分，直接跳过
+    qint64 i = kMinSize;
+    for (; i < normal; ++i) {
+        fingerprint = (fingerprint << 1) + kGear[data[i]];
+        if (!(fingerprint & kMaskStrict)) return i + 1;
+    }
+    for (; i < end; ++i) {
+        fingerprint = (fingerprint << 1) + kGear[data[i]];
+        if (!(fingerprint & kMaskLoose)) return i + 1;
+    }
+    return end;
+}
+
+QList<CdcChunk> FastCdc::chunkFile(const QString &filePath,
+                                   const FaststartLayout &layout,
+                                   const std::atomic<bool> &cancelled,
+                                   const std::function<void(qint64)> &progress,
+                                   QString *errorString)
+{
+    QList<CdcChunk> chunks;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorString = file.errorString();
+        return chunks;
+    }
+
+    // 数据流就是文件本身且能映射时，直接在映射区上分块和计算哈希，省去读入缓冲区的复制
+    qint64 size = layout.size;
+    if (uchar *map = size > 0 && !layout.remuxed ? file.map(0, size) : nullptr) {
+        qint64 reported = 0;
+        for (qint64 offset = 0; offset < size;) {
+            if (cancelled) {
+                file.unmap(map);
+                return {};
+            }
+            qint64 length = cutPoint(map + offset, size - offset);
+            chunks.append(makeChunk(offset, QByteArrayView(map + offset, length)));
+            offset += length;
+            if (progress && offset - reported >= kReadSize) {
+                reported = offset;
+                progress(offset);
+            }
+        }
+        file.unmap(map);
+        if (progress) progress(size);
+        return chunks;
+    }
+
+    // 缓冲区中保留不足一个最大块的尾部，与下一次读取的数据拼接
+    QByteArray buffer;
+    qint64 offset = 0;
+    qint64 readOffset = 0;
+    bool atEnd = false;
+    while (!atEnd || !buffer.isEmpty()) {
+        if (cancelled) return {};
+
+        if (!atEnd && buffer.size() < kMaxSize) {
+            qint64 want = qMin(kReadSize, size - readOffset);
+            if (want <= 0) {
+                atEnd = true;
+                continue;
+            }
+            QByteArray block(want, Qt::Uninitialized);
+            if (!layout.read(file, nullptr, readOffset, block.data(), want)) {
+                *errorString = file.error() != QFileDevice::NoError ? file.errorString() : QString("文件读取不完整");
+                return {};
+            }
+            readOffset += want;
+            buffer.append(block);
+            continue;
+        }
+
+        const uchar *data = reinterpret_cast<const uchar *>(buffer.constData());
+        qint64 pos = 0;
+        while (buffer.size() - pos >= kMaxSize || (atEnd && pos < buffer.size())) {
+            qint64 length = cutPoint(data + pos, buffer.size() - pos);
+            chunks.append(makeChunk(offset, QByteArrayView(buffer).sliced(pos, length)));
+
+            offset += length;
+            pos += length;
+        }
+        buffer.remove(0, pos);
+        if (progress) progress(offset);
+    }
+    return chunks;
+}
@@ -0,0 +1,39 @@
+//fastcdc.h
+//FastCDC内容定义分块：Gear滚动哈希找切点，切点只取决于附近的内容
+//文件头部被剪掉或插入数据后，后面的块边界仍然不变，服务器已有的块不必重传
+//平均块大小1 MiB（最小256 KiB，最大4 MiB），到达平均大小前用更严格的掩码，使块大小集中在平均值附近
+
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include "mp4faststart.h"
+#include <atomic>
+#include <functional>
+
+// 一个内容定义的块
+struct CdcChunk
+{
+    qint64 offset = 0;
+    qint64 length = 0;
+    QByteArray hash;  // SHA-256，十六进制
+};
+
+class FastCdc
+{
+public:
+    static constexpr qint64 kMinSize = 256 * 1024;
+    static constexpr qint64 kAvgSize = 1024 * 1024;
+    static constexpr qint64 kMaxSize = 4 * 1024 * 1024;
+
+    // 返回从data开始的第一个块的长度，length不足kMaxSize时视为文件末尾
+    static qint64 cutPoint(const uchar *data, qint64 length);
+
+    // 对整个上传数据流分块并计算每块的SHA-256，progress报告已处理的字节数；cancelled置位时返回空列表
+    static QList<CdcChunk> chunkFile(const QString &filePath,
+                                     const FaststartLayout &layout,
+                                     const std::atomic<bool> &cancelled,
+                                     const std::function<void(qint64)> &progress,
+                                     QString *errorString);
+};
@@ -0,0 +1,336 @@
+//imagescaler.cpp
+//权重用14位定点数，每个输出位置的权重之和恰好为1<<14，纯色区域缩小后颜色不变
+//横向一遍的结果保留8位小数（uint16），纵向一遍累加后一次舍入，两遍之间不损失精度
+//预乘Alpha的四个通道相互独立，按字节处理，与通道顺序无关
+
+#include "imagescaler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IMAGESCALER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(IMAGESCALER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define IMAGESCALER_TARGET(name) __attribute__((target(name)))
+#else
+#define IMAGESCALER_TARGET(name)
+#endif
+
+namespace {
+
+constexpr int kWeightBits = 14;
+constexpr int kWeightOne = 1 << kWeightBits;
+constexpr int kFractionBits = 8;  // 横向结果保留的小数位
+constexpr int kHorizontalShift = kWeightBits - kFractionBits;
+constexpr int kVerticalShift = kWeightBits + kFractionBits;
+
+// 每个输出位置覆盖的源像素：从first开始的count个，权重在weights[i * stride]起
+struct Taps
+{
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<int32_t> weights;
+    int stride = 0;
+};
+
+Taps makeTaps(int sourceSize, int targetSize)
+{
+    Taps taps;
+    double scale = static_cast<double>(sourceSize) / targetSize;
+    taps.stride = static_cast<int>(std::ceil(scale)) + 1;
+    taps.first.resize(targetSize);
+    taps.count.resize(targetSize);
+    taps.weights.assign(static_cast<size_t>(targetSize) * taps.stride, 0);
+
+    for (int i = 0; i < targetSize; ++i) {
+        double start = i * scale;
+        double end = (i + 1) * scale;
+        int first = static_cast<int>(std::floor(start));
+        int last = std::min(sourceSize, static_cast<int>(std::ceil(end)));
+        int32_t *weights = taps.weights.data() + static_cast<size_t>(i) * taps.stride;
+
+        int sum = 0;
+        int largest = 0;
+        for (int s = first; s < last; ++s) {
+            double coverage = std::min(end, s + 1.0) - std::max(start, static_cast<double>(s));
+            int weight = static_cast<int>(coverage / scale * kWeightOne + 0.5);
+            weights[s - first] = weight;
+            sum += weight;
+            if (weight > weights[largest]) largest = s - first;
+        }
+        weights[largest] += kWeightOne - sum;  // 舍入误差补到覆盖最多的像素上
+
+        taps.first[i] = first;
+        taps.count[i] = last - first;
+    }
+    return taps;
+}
+
+// 横向：一行源像素（每像素4字节）缩成targetWidth个像素，每通道uint16
+void horizontalScalar(const uchar *source, uint16_t *target, int targetWidth, const Taps &taps)
+{
+    for (int x = 0; x < targetWidth; ++x) {
+        const uchar *p = source + taps.first[x] * 4;
+        const int32_t *weights = taps.weights.data() + static_cast<size_t>(x) * taps.stride;
+        int32_t sum[4] = {0, 0, 0, 0};
+        for (int k = 0; k < taps.count[x]; ++k) {
+            for (int c = 0; c < 4; ++c) sum[c] += p[k * 4 + c] * weights[k];
+        }
+        for (int c = 0; c < 4; ++c) {
+            target[x * 4 + c] = static_cast<uint16_t>((sum[c] + (1 << (kHorizontalShift - 1))) >> kHorizontalShift);
+        }
+    }
+}
+
+// 纵向：count行横向结果的第begin到end个通道按权重累加，写入输出行
+void verticalRange(const uint16_t *const *rows, const int32_t *weights, int count, uchar *target, int begin, int end)
+{
+    for (int i = begin; i < end; ++i) {
+        int32_t sum = 1 << (kVerticalShift - 1);
+        for (int k = 0; k < count; ++k) sum += rows[k][i] * weights[k];
+        target[i] = static_cast<uchar>(std::min(255, sum >> kVerticalShift));
+    }
+}
+
+// length为每行的通道数
+void verticalScalar(const uint16_t *const *rows, const int32_t *weights, int count, uchar *target, int length)
+{
+    verticalRange(rows, weights, count, target, 0, length);
+}
+
+#if defined(IMAGESCALER_X86)
+
+// 一个像素的4个通道放在4个32位通道中同时乘加
+IMAGESCALER_TARGET("sse4.1")
+void horizontalSse41(const uchar *source, uint16_t *target, int targetWidth, const Taps &taps)
+{
+    const __m128i round = _mm_set1_epi32(1 << (kHorizontalShift - 1));
+    for (int x = 0; x < targetWidth; ++x) {
+        const uchar *p = source + taps.first[x] * 4;
+        const int32_t *weights = taps.weights.data() + static_cast<size_t>(x) * taps.stride;
+        __m128i sum = round;
+        for (int k = 0; k < taps.count[x]; ++k) {
+            int32_t pixel;
+            std::memcpy(&pixel, p + k * 4, 4);
+            __m128i channels = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(pixel));
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(channels, _mm_set1_epi32(weights[k])));
+        }
+        sum = _mm_srli_epi32(sum, kHorizontalShift);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(target + x * 4), _mm_packus_epi32(sum, sum));
+    }
+}
+
+IMAGESCALER_TARGET("sse4.1")
+void verticalSse41(const uint16_t *const *rows, const int32_t *weights, int count, uchar *target, int length)
+{
+    const __m128i round = _mm_set1_epi32(1 << (kVerticalShift - 1));
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m128i low = round;
+        __m128i high = round;
+        for (int k = 0; k < count; ++k) {
+            __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[k] + i));
+            __m128i weight = _mm_set1_epi32(weights[k]);
+            low = _mm_add_epi32(low, _mm_mullo_epi32(_mm_cvtepu16_epi32(values), weight));
+            high = _mm_add_epi32(high, _mm_mullo_epi32(_mm_cvtepu16_epi32(_mm_srli_si128(values, 8)), weight));
+        }
+        __m128i words = _mm_packus_epi32(_mm_srli_epi32(low, kVerticalShift), _mm_srli_epi32(high, kVerticalShift));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(target + i), _mm_packus_epi16(words, words));
+    }
+    verticalRange(rows, weights, count, target, i, length);  // 每行像素数为奇数时剩下4个通道
+}
+
+// 两个相邻输出像素各占一个128位半边；源像素数不同时较少的一方补权重0
+IMAGESCALER_TARGET("avx2")
+void horizontalAvx2(const uchar *source, uint16_t *target, int targetWidth, const Taps &taps)
+{
+    const __m256i round = _mm256_set1_epi32(1 << (kHorizontalShift - 1));
+    int x = 0;
+    for (; x + 2 <= targetWidth; x += 2) {
+        const uchar *p0 = source + taps.first[x] * 4;
+        const uchar *p1 = source + taps.first[x + 1] * 4;
+        const int32_t *weights0 = taps.weights.data() + static_cast<size_t>(x) * taps.stride;
+        const int32_t *weights1 = weights0 + taps.stride;
+        const int count0 = taps.count[x];
+        const int count1 = taps.count[x + 1];
+        __m256i sum = round;
+        for (int k = 0; k < std::max(count0, count1); ++k) {
+            // 超出范围的位置不读取，避免越过行尾；权重数组中超出count的部分为0
+            int32_t pixel0 = 0;
+            int32_t pixel1 = 0;
+            if (k < count0) std::memcpy(&pixel0, p0 + k * 4, 4);
+            if (k < count1) std::memcpy(&pixel1, p1 + k * 4, 4);
+            __m256i channels = _mm256_cvtepu8_epi32(_mm_setr_epi32(pixel0, pixel1, 0, 0));
+            __m256i weight = _mm256_setr_epi32(weights0[k], weights0[k], weights0[k], weights0[k],
+                                               weights1[k], weights1[k], weights1[k], weights1[k]);
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(channels, weight));
+        }
+        sum = _mm256_srli_epi32(sum, kHorizontalShift);
+        __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(target + x * 4), words);
+    }
+    if (x < targetWidth) {
+        const uchar *p = source + taps.first[x] * 4;
+        const int32_t *weights = taps.weights.data() + static_cast<size_t>(x) * taps.stride;
+        __m128i sum = _mm256_castsi256_si128(round);
+        for (int k = 0; k < taps.count[x]; ++k) {
+            int32_t pixel;
+            std::memcpy(&pixel, p + k * 4, 4);
+            __m128i channels = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(pixel));
+            sum = _mm_add_epi32(sum, _mm_mullo_epi32(channels, _mm_set1_epi32(weights[k])));
+        }
+        sum = _mm_srli_epi32(sum, kHorizontalShift);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(target + x * 4), _mm_packus_epi32(sum, sum));
+    }
+}
+
+IMAGESCALER_TARGET("avx2")
+void verticalAvx2(const uint16_t *const *rows, const int32_t *weights, int count, uchar *target, int length)
+{
+    const __m256i round = _mm256_set1_epi32(1 << (kVerticalShift - 1));
+    int i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m256i low = round;
+        __m256i high = round;
+        for (int k = 0; k < count; ++k) {
+            __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[k] + i));
+            __m256i weight = _mm256_set1_epi32(weights[k]);
+            low = _mm256_add_epi32(low, _mm256_mullo_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(values)), weight));
+            high = _mm256_add_epi32(high, _mm256_mullo_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(values, 1)), weight));
+        }
+        // packus在每个128位半边内交错，之后按64位重排回原顺序
+        __m256i words = _mm256_packus_epi32(_mm256_srli_epi32(low, kVerticalShift), _mm256_srli_epi32(high, kVerticalShift));
+        words = _mm256_permute4x64_epi64(words, 0xD8);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(target + i), bytes);
+    }
+    verticalRange(rows, weights, count, target, i, length);
+}
+
+enum class InstructionSet { Scalar, Sse41, Avx2 };
+
+InstructionSet detectInstructionSet()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool osAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0  // OSXSAVE、AVX
+                 && (_xgetbv(0) & 0x6) == 0x6;                                // 操作系统保存YMM寄存器
+    bool avx2 = false;
+    if (osAvx && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;  // EBX.AVX2
+    }
+#else
+    __builtin_cpu_init();
+    bool sse41 = __builtin_cpu_supports("sse4.1");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return InstructionSet::Avx2;
+    if (sse41) return InstructionSet::Sse41;
+    return InstructionSet::Scalar;
+}
+
+#else
+
+enum class InstructionSet { Scalar };
+
+InstructionSet detectInstructionSet()
+{
+    return InstructionSet::Scalar;
+}
+
+#endif
+
+const InstructionSet kInstructionSet = detectInstructionSet();
+
+using HorizontalKernel = void (*)(const uchar *, uint16_t *, int, const Taps &);
+using VerticalKernel = void (*)(const uint16_t *const *, const int32_t *, int, uchar *, int);
+
+HorizontalKernel horizontalKernel()
+{
+#if defined(IMAGESCALER_X86)
+    if (kInstructionSet == InstructionSet::Avx2) return horizontalAvx2;
+    if (kInstructionSet == InstructionSet::Sse41) return horizontalSse41;
+#endif
+    return horizontalScalar;
+}
+
+VerticalKernel verticalKernel()
+{
+#if defined(IMAGESCALER_X86)
+    if (kInstructionSet == InstructionSet::Avx2) return verticalAvx2;
+    if (kInstructionSet == InstructionSet::Sse41) return verticalSse41;
+#endif
+    return verticalScalar;
+}
+
+}
+
+namespace ImageScaler {
+
+QImage downscale(const QImage &image, const QSize &size, Qt::AspectRatioMode mode)
+{
+    if (image.isNull() || size.isEmpty()) return QImage();
+
+    QSize targetSize = image.size().scaled(size, mode);
+    targetSize = targetSize.expandedTo(QSize(1, 1));
+    if (targetSize == image.size()) return image;
+    if (targetSize.width() > image.width() || targetSize.height() > image.height()) {
+        return image.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QImage source = image;
+    if (source.format() != QImage::Format_RGB32 && source.format() != QImage::Format_ARGB32_Premultiplied) {
+        source = source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    const int targetWidth = targetSize.width();
+    const int targetHeight = targetSize.height();
+    const Taps columns = makeTaps(source.width(), targetWidth);
+    const Taps rows = makeTaps(source.height(), targetHeight);
+    const HorizontalKernel horizontal = horizontalKernel();
+    const VerticalKernel vertical = verticalKernel();
+
+    // 横向结果全部保留，相邻输出行共用的源行只算一次
+    const int length = targetWidth * 4;
+    std::vector<uint16_t> intermediate(static_cast<size_t>(source.height()) * length);
+    for (int y = 0; y < source.height(); ++y) {
+        horizontal(source.constScanLine(y), intermediate.data() + static_cast<size_t>(y) * length, targetWidth, columns);
+    }
+
+    QImage target(targetSize, source.format());
+    if (target.isNull()) return QImage();
+    std::vector<const uint16_t *> rowPointers(rows.stride);
+    for (int y = 0; y < targetHeight; ++y) {
+        for (int k = 0; k < rows.count[y]; ++k) {
+            rowPointers[k] = intermediate.data() + static_cast<size_t>(rows.first[y] + k) * length;
+        }
+        vertical(rowPointers.data(), rows.weights.data() + static_cast<size_t>(y) * rows.stride, rows.count[y],
+                 target.scanLine(y), length);
+    }
+    return target;
+}
+
+const char *instructionSet()
+{
+#if defined(IMAGESCALER_X86)
+    if (kInstructionSet == InstructionSet::Avx2) return "AVX2";
+    if (kInstructionSet == InstructionSet::Sse41) return "SSE4.1";
+#endif
+    return "scalar";
+}
+
+}
@@ -0,0 +1,20 @@
+//imagescaler.h
+//面积平均缩小：每个输出像素取它在原图中覆盖区域的加权平均，边缘按覆盖比例计权，缩小倍数不是整数时也不会产生摩尔纹
+//先横向、再纵向两遍，定点整数运算；x86上运行时检测，AVX2 / SSE4.1指令加速，不支持时使用普通循环
+//用于缩略图、拼图切片和封面帧这类缩小场景，放大时退回QImage::scaled
+
+#pragma once
+
+#include <QImage>
+#include <QSize>
+
+namespace ImageScaler {
+
+// 与QImage::scaled(size, mode, Qt::SmoothTransformation)的结果尺寸相同
+// 结果为Format_ARGB32_Premultiplied（原图为Format_RGB32时保持不变）
+QImage downscale(const QImage &image, const QSize &size, Qt::AspectRatioMode mode = Qt::IgnoreAspectRatio);
+
+// 当前CPU使用的实现："AVX2"、"SSE4.1" 或 "scalar"
+const char *instructionSet();
+
+}
@@ -0,0 +1,89 @@
+//imagescalerbenchmark.cpp
+//ImageScaler与QImage::scaled(Qt::SmoothTransformation)的耗时对比，列表中实际用到的几种缩小比例
+//配置时打开 VIDSPHERE_BUILD_BENCHMARKS 后生成，不随客户端安装
+
+#include "imagescaler.h"
+#include <QElapsedTimer>
+#include <QImage>
+#include <QRandomGenerator>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// 随机噪声加渐变，避免纯色图片走捷径
+QImage makeSource(const QSize &size)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    QRandomGenerator random(42);
+    for (int y = 0; y < size.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            int noise = random.bounded(64);
+            line[x] = qRgb(x * 191 / size.width() + noise, y * 191 / size.height() + noise, noise * 3);
+        }
+    }
+    return image;
+}
+
+template <typename Function>
+double microsecondsPerCall(int iterations, Function function)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) function();
+    return timer.nsecsElapsed() / 1000.0 / iterations;
+}
+
+// 与Qt结果的最大通道差，确认两者缩小的是同一区域
+int maxDifference(const QImage &a, const QImage &b)
+{
+    if (a.size() != b.size()) return 255;
+    int difference = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        const uchar *lineA = a.constScanLine(y);
+        const uchar *lineB = b.constScanLine(y);
+        for (int i = 0; i < a.width() * 4; ++i) difference = qMax(difference, std::abs(lineA[i] - lineB[i]));
+    }
+    return difference;
+}
+
+}
+
+int main()
+{
+    struct Case
+    {
+        QSize source;
+        QSize target;
+        Qt::AspectRatioMode mode;
+        const char *name;
+    };
+    const Case cases[] = {
+        {QSize(320, 180), QSize(116, 90), Qt::KeepAspectRatio, "grid tile"},
+        {QSize(320, 180), QSize(232, 180), Qt::KeepAspectRatio, "grid tile, dpr=2"},
+        {QSize(320, 180), QSize(184, 140), Qt::KeepAspectRatio, "video card"},
+        {QSize(320, 180), QSize(116, 90), Qt::IgnoreAspectRatio, "stretched 116x90"},
+        {QSize(1920, 1080), QSize(320, 180), Qt::IgnoreAspectRatio, "upload poster"},
+    };
+
+    std::printf("ImageScaler: %s\n", ImageScaler::instructionSet());
+    std::printf("%-24s %12s %12s %8s %8s\n", "case", "Qt (us)", "ours (us)", "speedup", "maxdiff");
+    for (const Case &c : cases) {
+        const QImage source = makeSource(c.source);
+        const int iterations = c.source.width() > 1000 ? 50 : 1000;
+
+        QImage qtResult;
+        QImage ourResult;
+        double qtTime = microsecondsPerCall(iterations, [&]() {
+            qtResult = source.scaled(c.target, c.mode, Qt::SmoothTransformation);
+        });
+        double ourTime = microsecondsPerCall(iterations, [&]() {
+            ourResult = ImageScaler::downscale(source, c.target, c.mode);
+        });
+
+        std::printf("%-24s %12.1f %12.1f %7.2fx %8d\n", c.name, qtTime, ourTime, qtTime / ourTime,
+                    maxDifference(qtResult.convertToFormat(QImage::Format_ARGB32_Premultiplied), ourResult));
+    }
+    return 0;
+}
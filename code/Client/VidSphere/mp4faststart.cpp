@@ -0,0 +1,299 @@
+//mp4faststart.cpp
+//只展开 moov/trak/mdia/minf/stbl 这几层容器，其余盒子原样保留
+//moov插到第一个mdat前面：原来在插入点和moov之间的数据后移新moov的长度，moov之后的数据后移新旧moov的长度差
+
+#include "mp4faststart.h"
+#include <QtEndian>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+struct TopLevelBox
+{
+    QByteArray type;
+    qint64 offset = 0;
+    qint64 size = 0;
+};
+
+// moov中的盒子
+struct Box
+{
+    QByteArray type;
+    QByteArray payload;  // 叶子盒子头部之后的内容
+    QList<Box> children;
+    bool container = false;
+};
+
+enum PatchResult {
+    Patched,
+    Overflow,   // stco放不下新的偏移，需要升级为co64
+    Malformed
+};
+
+bool isContainer(const QByteArray &type)
+{
+    return type == "moov" || type == "trak" || type == "mdia" || type == "minf" || type == "stbl";
+}
+
+// 解析盒子头部，返回头部长度；available为可读的头部字节数，remaining为盒子最多能占的长度（size为0时到末尾）
+int parseHeader(const uchar *p, qint64 available, qint64 remaining, qint64 *size, QByteArray *type)
+{
+    if (available < 8) return 0;
+    quint32 size32 = qFromBigEndian<quint32>(p);
+    *type = QByteArray(reinterpret_cast<const char *>(p + 4), 4);
+    if (size32 == 1) {
+        if (available < 16) return 0;
+        *size = qint64(qFromBigEndian<quint64>(p + 8));
+        return *size >= 16 ? 16 : 0;
+    }
+    *size = size32 == 0 ? remaining : size32;
+    return *size >= 8 ? 8 : 0;
+}
+
+bool parseBoxes(const uchar *p, qint64 length, QList<Box> *boxes)
+{
+    qint64 pos = 0;
+    while (pos < length) {
+        qint64 size = 0;
+        QByteArray type;
+        int header = parseHeader(p + pos, length - pos, length - pos, &size, &type);
+        if (!header || size > length - pos) return false;
+
+        Box box;
+        box.type = type;
+        if (isContainer(type)) {
+            box.container = true;
+            if (!parseBoxes(p + pos + header, size - header, &box.children)) return false;
+        } else {
+            box.payload = QByteArray(reinterpret_cast<const char *>(p + pos + header), size - header);
+        }
+        boxes->append(box);
+        pos += size;
+    }
+    return true;
+}
+
+// upgrade为true时stco按co64计算
+qint64 boxSize(const Box &box, bool upgrade)
+{
+    qint64 content = box.payload.size();
+    if (box.container) {
+        content = 0;
+        for (const Box &child : box.children) { content += boxSize(child, upgrade); }
+    } else if (upgrade && box.type == "stco" && box.payload.size() >= 8) {
+        content += qint64(qFromBigEndian<quint32>(box.payload.constData() + 4)) * 4;
+    }
+    return content + (content + 8 > 0xFFFFFFFFLL ? 16 : 8);
+}
+
+PatchResult patchOffsets(QList<Box> &boxes, const std::function<quint64(quint64)> &shift, bool upgrade)
+{
+    for (Box &box : boxes) {
+        if (box.container) {
+            PatchResult result = patchOffsets(box.children, shift, upgrade);
+            if (result != Patched) return result;
+            continue;
+        }
+
+        bool co64 = box.type == "co64";
+        if (box.type != "stco" && !co64) continue;
+        if (box.payload.size() < 8) return Malformed;
+
+        // 4字节version/flags，4字节条目数，然后是偏移表
+        quint32 count = qFromBigEndian<quint32>(box.payload.constData() + 4);
+        int entrySize = co64 ? 8 : 4;
+        if (box.payload.size() < 8 + qint64(count) * entrySize) return Malformed;
+
+        if (!co64 && upgrade) {
+            QByteArray out(8 + qint64(count) * 8, Qt::Uninitialized);
+            std::memcpy(out.data(), box.payload.constData(), 8);
+            for (quint32 i = 0; i < count; ++i) {
+                quint64 offset = qFromBigEndian<quint32>(box.payload.constData() + 8 + i * 4);
+                qToBigEndian<quint64>(shift(offset), out.data() + 8 + i * 8);
+            }
+            box.type = "co64";
+            box.payload = out;
+            continue;
+        }
+
+        char *entries = box.payload.data() + 8;
+        for (quint32 i = 0; i < count; ++i) {
+            if (co64) {
+                qToBigEndian<quint64>(shift(qFromBigEndian<quint64>(entries + i * 8)), entries + i * 8);
+            } else {
+                quint64 offset = shift(qFromBigEndian<quint32>(entries + i * 4));
+                if (offset > 0xFFFFFFFFULL) return Overflow;
+                qToBigEndian<quint32>(quint32(offset), entries + i * 4);
+            }
+        }
+    }
+    return Patched;
+}
+
+void serialize(const QList<Box> &boxes, QByteArray *out)
+{
+    for (const Box &box : boxes) {
+        qint64 size = boxSize(box, false);
+        char header[16];
+        if (size > 0xFFFFFFFFLL) {
+            qToBigEndian<quint32>(1, header);
+            std::memcpy(header + 4, box.type.constData(), 4);
+            qToBigEndian<quint64>(size, header + 8);
+            out->append(header, 16);
+        } else {
+            qToBigEndian<quint32>(quint32(size), header);
+            std::memcpy(header + 4, box.type.constData(), 4);
+            out->append(header, 8);
+        }
+
+        if (box.container) {
+            serialize(box.children, out);
+        } else {
+            out->append(box.payload);
+        }
+    }
+}
+
+}
+
+FaststartLayout FaststartLayout::identity(qint64 fileSize)
+{
+    FaststartLayout layout;
+    if (fileSize > 0) {
+        Segment segment;
+        segment.length = fileSize;
+        layout.segments.append(segment);
+    }
+    layout.size = fileSize;
+    return layout;
+}
+
+bool FaststartLayout::read(QFile &file, const uchar *map, qint64 offset, char *out, qint64 length) const
+{
+    qint64 segmentStart = 0;
+    for (const Segment &segment : segments) {
+        qint64 segmentEnd = segmentStart + segment.length;
+        if (length > 0 && offset < segmentEnd) {
+            qint64 inSegment = offset - segmentStart;
+            qint64 n = qMin(length, segment.length - inSegment);
+            if (!segment.data.isEmpty()) {
+                std::memcpy(out, segment.data.constData() + inSegment, n);
+            } else if (map) {
+                std::memcpy(out, map + segment.sourceOffset + inSegment, n);
+            } else if (!file.seek(segment.sourceOffset + inSegment) || file.read(out, n) != n) {
+                return false;
+            }
+            out += n;
+            offset += n;
+            length -= n;
+        }
+        segmentStart = segmentEnd;
+    }
+    return length == 0;
+}
+
+qint64 FaststartLayout::sourceOffset(qint64 offset, qint64 length) const
+{
+    qint64 segmentStart = 0;
+    for (const Segment &segment : segments) {
+        qint64 segmentEnd = segmentStart + segment.length;
+        if (offset < segmentEnd) {
+            if (!segment.data.isEmpty() || offset + length > segmentEnd) return -1;
+            return segment.sourceOffset + offset - segmentStart;
+        }
+        segmentStart = segmentEnd;
+    }
+    return -1;
+}
+
+bool Mp4Faststart::plan(const QString &filePath, FaststartLayout *layout, QString *errorString)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorString = file.errorString();
+        return false;
+    }
+    qint64 fileSize = file.size();
+    *layout = FaststartLayout::identity(fileSize);
+
+    // 顶层盒子，结构不对就不是MP4，原样上传
+    QList<TopLevelBox> boxes;
+    for (qint64 offset = 0; offset < fileSize;) {
+        uchar header[16];
+        if (!file.seek(offset)) return true;
+        qint64 available = file.read(reinterpret_cast<char *>(header), sizeof(header));
+
+        TopLevelBox box;
+        box.offset = offset;
+        if (!parseHeader(header, available, fileSize - offset, &box.size, &box.type) || box.size > fileSize - offset) {
+            return true;
+        }
+        boxes.append(box);
+        offset += box.size;
+    }
+
+    int moov = -1;
+    int firstMdat = -1;
+    for (int i = 0; i < boxes.size(); ++i) {
+        if (boxes[i].type == "moof") return true;  // 分片MP4本来就可以边下边播
+        if (boxes[i].type == "moov" && moov < 0) moov = i;
+        if (boxes[i].type == "mdat" && firstMdat < 0) firstMdat = i;
+    }
+    if (moov < 0 || firstMdat < 0 || moov < firstMdat || boxes[moov].size > kMaxMoovSize) return true;
+
+    const qint64 moovStart = boxes[moov].offset;
+    const qint64 oldSize = boxes[moov].size;
+    const qint64 moovEnd = moovStart + oldSize;
+    const qint64 insertAt = boxes[firstMdat].offset;
+
+    QByteArray moovData(oldSize, Qt::Uninitialized);
+    if (!file.seek(moovStart) || file.read(moovData.data(), oldSize) != oldSize) {
+        *errorString = file.errorString();
+        return false;
+    }
+    QList<Box> parsed;
+    if (!parseBoxes(reinterpret_cast<const uchar *>(moovData.constData()), oldSize, &parsed) || parsed.size() != 1) {
+        return true;
+    }
+
+    // 先按stco尝试，有偏移超过4 GiB时全部升级为co64，moov变大后偏移要重新计算
+    for (bool upgrade : {false, true}) {
+        const qint64 newSize = boxSize(parsed.first(), upgrade);
+        auto shift = [=](quint64 offset) -> quint64 {
+            if (offset < quint64(insertAt)) return offset;
+            if (offset < quint64(moovStart)) return offset + newSize;
+            if (offset >= quint64(moovEnd)) return offset + newSize - oldSize;
+            return offset;
+        };
+
+        QList<Box> patched = parsed;
+        PatchResult result = patchOffsets(patched, shift, upgrade);
+        if (result == Malformed) return true;
+        if (result == Overflow) continue;
+
+        FaststartLayout::Segment newMoov;
+        newMoov.data.reserve(newSize);
+        serialize(patched, &newMoov.data);
+        newMoov.length = newMoov.data.size();
+
+        QList<FaststartLayout::Segment> segments;
+        auto addSource = [&segments](qint64 start, qint64 end) {
+            if (end <= start) return;
+            FaststartLayout::Segment segment;
+            segment.sourceOffset = start;
+            segment.length = end - start;
+            segments.append(segment);
+        };
+        addSource(0, insertAt);
+        segments.append(newMoov);
+        addSource(insertAt, moovStart);
+        addSource(moovEnd, fileSize);
+
+        layout->segments = segments;
+        layout->size = fileSize - oldSize + newMoov.length;
+        layout->remuxed = true;
+        return true;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+//mp4faststart.h
+//MP4快速启动：moov在mdat之后的文件，播放器要先取到文件末尾才能显示第一帧
+//上传时把moov移到mdat前面并修正stco/co64中的块偏移，偏移超过4 GiB时stco升级为co64
+//不生成临时文件：上传的数据流由文件中的区间和改写后的moov拼接而成，只有moov保存在内存里
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+// 上传数据流的组成，未改写时为整个文件一个区间
+struct FaststartLayout
+{
+    struct Segment
+    {
+        qint64 sourceOffset = 0;  // 在文件中的偏移，data非空时不使用
+        qint64 length = 0;
+        QByteArray data;          // 改写后的moov
+    };
+
+    QList<Segment> segments;
+    qint64 size = 0;
+    bool remuxed = false;
+
+    static FaststartLayout identity(qint64 fileSize);
+
+    // 把数据流 [offset, offset+length) 读到out，map非空时从映射区复制，否则从file读
+    bool read(QFile &file, const uchar *map, qint64 offset, char *out, qint64 length) const;
+    // 区间完全落在某个文件区间内时返回它在文件中的偏移，否则返回-1
+    qint64 sourceOffset(qint64 offset, qint64 length) const;
+};
+
+class Mp4Faststart
+{
+public:
+    // 分析文件并返回上传数据流；不是MP4、moov已在前面、分片MP4或结构无法识别时原样上传
+    // 只有无法读取文件时返回false
+    static bool plan(const QString &filePath, FaststartLayout *layout, QString *errorString);
+
+private:
+    static constexpr qint64 kMaxMoovSize = 64 * 1024 * 1024;  // moov要整个读进内存改写
+};
@@ -0,0 +1,11 @@
+//networklimits.h
+//各模块共用的网络并发上限
+
+#pragma once
+
+namespace NetworkLimits {
+
+// QNetworkAccessManager对同一主机最多同时打开的HTTP/1.1连接数，超出的请求在其内部排队
+constexpr int kConnectionsPerHost = 6;
+
+}
@@ -5,6 +5,13 @@
 #include "video.h"
 #include "downloadvideowidget.h"
 #include "playvideo.h"
+#include "downloadmanager.h"
+#include "downloadmanagerdialog.h"
+#include "uploadmanager.h"
+#include "uploadmanagerdialog.h"
+#include "thumbnailloader.h"
+#include "videolistmodel.h"
+#include "videoitemdelegate.h"
 #include <QTimer>
 #include <QPropertyAnimation>
 #include <QGraphicsOpacityEffect>
@@ -24,6 +31,8 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QScrollArea>
+#include <QScrollBar>
+#include <QListView>
 #include <QGridLayout>
 #include <QStackedWidget>
 #include <QToolButton>
@@ -33,6 +42,80 @@
 #include <QHttpMultiPart>
 #include <QDesktopServices>
 #include <QFileInfo>
+#include <QUrlQuery>
+#include <QSet>
+#include <utility>
+
+namespace {
+
+// 每页的视频数，6列的整数倍；重新获取已加载的部分时每页最多取服务器允许的上限
+const int kCatalogPageSize = 120;
+const int kMaxCatalogPageSize = 500;
+
+// 两次滚动间隔超过这个时间视为已停下
+const int kScrollSettleMs = 500;
+
+// 服务器返回的一页视频列表
+struct CatalogPage
+{
+    QList<VideoListModel::Video> videos;
+    QString nextCursor;  // 为空时没有更多
+    int total = -1;      // 旧服务器不提供
+    QString errorString; // 格式错误时要显示的状态
+};
+
+// 解析服务器返回的视频列表，在工作线程中调用
+// 分页的服务器已按上传时间从新到旧排列；旧服务器一次返回全部，倒过来使最新上传的在前
+CatalogPage parseVideoList(const QByteArray &responseData, const QString &serverAddress)
+{
+    CatalogPage page;
+
+    // 解析 JSON
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(responseData);
+    if (!jsonDoc.isObject()) {
+        page.errorString = "服务器响应格式错误";
+        return page;
+    }
+
+    QJsonObject jsonObj = jsonDoc.object();
+    if (!jsonObj.contains("videos") || !jsonObj["videos"].isArray()) {
+        page.errorString = "未找到视频列表";
+        return page;
+    }
+
+    const bool paged = jsonObj.contains("next_cursor");
+    page.nextCursor = jsonObj["next_cursor"].toString();
+    page.total = jsonObj["total"].toInt(-1);
+
+    QJsonArray videosArray = jsonObj["videos"].toArray();
+    page.videos.reserve(videosArray.size());
+
+    for (int n = 0; n < videosArray.size(); ++n) {
+        QJsonValue value = videosArray.at(paged ? n : videosArray.size() - 1 - n);
+        if (value.isObject()) {
+            QJsonObject videoObj = value.toObject();
+            QString name = videoObj["name"].toString();
+            QString url = videoObj["url"].toString();
+            QString downloadUrl = videoObj["download_url"].toString(); // 获取下载链接
+            QString author = videoObj["author"].toString();            // 假设服务器返回作者信息
+            QString thumbnail = videoObj["thumbnail"].toString();      // 假设服务器返回缩略图URL
+            QString blurhash = videoObj["blurhash"].toString();        // 缩略图的模糊占位，旧服务器没有
+
+            // 如果缩略图URL是相对路径，构建完整URL
+            if (!thumbnail.isEmpty() && thumbnail.startsWith("/")) {
+                thumbnail = serverAddress + thumbnail;
+            }
+
+            if (!name.isEmpty() && !url.isEmpty()) {
+                // 行号即点击时onVideoSelected收到的序号
+                page.videos.append({name, url, downloadUrl, author, thumbnail, blurhash});
+            }
+        }
+    }
+    return page;
+}
+
+}
 
 // 初始化视频流客户端主界面
 // 创建QNetworkAccessManager实例用于网络请求
@@ -41,7 +124,19 @@ PlayVideoUI::PlayVideoUI(QWidget *parent)
     , ui(new Ui::PlayVideoUI)
     , networkManager(new QNetworkAccessManager(this))
     , playVideoController(new PlayVideo(this))
-    , currentUploadFilePath("")
+    , downloadManager(new DownloadManager(networkManager, this))
+    , downloadDialog(nullptr)
+    , uploadManager(new UploadManager(networkManager, this))
+    , uploadDialog(nullptr)
+    , thumbnailLoader(new ThumbnailLoader(this))
+    , videoListModel(new VideoListModel(thumbnailLoader, this))
+    , catalogGeneration(0)
+    , catalogLoading(false)
+    , catalogTotal(-1)
+    , catalogRefreshing(false)
+    , refreshTarget(0)
+    , lastScrollValue(0)
+    , scrollVelocity(0)
 {
     ui->setupUi(this);
     // 设置客户端窗口
@@ -76,9 +171,49 @@ PlayVideoUI::PlayVideoUI(QWidget *parent)
     // 连接下载按钮到下载请求信号
     connect(ui->downloadButton, &QPushButton::clicked, this, &PlayVideoUI::onDownloadButtonClicked);
 
+    // 下载队列
+    connect(ui->downloadListButton, &QPushButton::clicked, this, &PlayVideoUI::onDownloadListButtonClicked);
+    connect(downloadManager, &DownloadManager::statsChanged, this, &PlayVideoUI::onDownloadStatsChanged);
+    connect(downloadManager, &DownloadManager::itemFinished, this, &PlayVideoUI::onDownloadFinished);
+
+    // 一屏的缩略图合并为一个拼图请求
+    thumbnailLoader->setAtlasEnabled(true);
+
+    // 视频网格：模型只保存字符串，委托只绘制可见的单元格
+    catalogPool.setMaxThreadCount(1);
+    ui->videoListView->setModel(videoListModel);
+    ui->videoListView->setItemDelegate(new VideoItemDelegate(ui->videoListView));
+    ui->videoListView->viewport()->setCursor(Qt::PointingHandCursor);
+    videoListModel->setThumbnailSize(VideoItemDelegate::kThumbnailSize, ui->videoListView->devicePixelRatioF());
+    connect(ui->videoListView, &QListView::clicked, this, [this](const QModelIndex &index) { onVideoSelected(index.row()); });
+
+    // 滚动、窗口大小或列表内容变化时重新计算哪些视频项在视口附近
+    QScrollBar *listScrollBar = ui->videoListView->verticalScrollBar();
+    connect(listScrollBar, &QScrollBar::valueChanged, this, &PlayVideoUI::onVideoListScrolled);
+    connect(listScrollBar, &QScrollBar::rangeChanged, this, &PlayVideoUI::updateThumbnailViewport);
+
+    // 快速滑动停下后不会再有滚动事件，由定时器把速度归零，恢复视口上下各一屏的预取
+    scrollSettleTimer.setSingleShot(true);
+    scrollSettleTimer.setInterval(kScrollSettleMs);
+    connect(&scrollSettleTimer, &QTimer::timeout, this, [this]() {
+        scrollVelocity = 0;
+        updateThumbnailViewport();
+    });
+
     // 连接上传按钮
     connect(ui->browseButton, &QPushButton::clicked, this, &PlayVideoUI::onBrowseButtonClicked);
     connect(ui->uploadButton, &QPushButton::clicked, this, &PlayVideoUI::onUploadButtonClicked);
+    connect(ui->folderButton, &QPushButton::clicked, this, &PlayVideoUI::onUploadFolderSelected);
+
+    // 上传队列；上次的监视文件夹在启动时恢复
+    if (!uploadManager->getWatchFolder().isEmpty()) {
+        ui->watchFolderButton->setChecked(true);
+        ui->watchFolderButton->setToolTip("监视中: " + uploadManager->getWatchFolder());
+    }
+    connect(ui->watchFolderButton, &QPushButton::toggled, this, &PlayVideoUI::onWatchFolderToggled);
+    connect(ui->uploadListButton, &QPushButton::clicked, this, &PlayVideoUI::onUploadListButtonClicked);
+    connect(uploadManager, &UploadManager::statsChanged, this, &PlayVideoUI::onUploadStatsChanged);
+    connect(uploadManager, &UploadManager::itemFinished, this, &PlayVideoUI::onUploadFinished);
     
     // 连接刷新按钮
     connect(ui->refreshButton, &QPushButton::clicked, this, &PlayVideoUI::onRefreshButtonClicked);
@@ -134,6 +269,12 @@ PlayVideoUI::PlayVideoUI(QWidget *parent)
 
 PlayVideoUI::~PlayVideoUI()
 {
+    // networkManager是第一个子对象，会先于上传、下载管理器销毁并删除所有回复；
+    // 先销毁两个管理器，让其中的任务在回复仍有效时中止请求
+    delete uploadDialog;
+    delete uploadManager;
+    delete downloadDialog;
+    delete downloadManager;
     delete ui;
 }
 
@@ -148,11 +289,12 @@ void PlayVideoUI::onConnectClicked()
         return;
     }
 
+    // 排队中的上传开始发往这个服务器
+    uploadManager->setServerAddress(serverAddress);
+
     //更新状态标签
     ui->statusLabel->setText("正在连接到服务器...");
     clearVideoList();
-    videoList.clear();
-    videoDetails.clear();
 
     // 获取视频列表
     loadVideoList();
@@ -184,14 +326,83 @@ void PlayVideoUI::showVideoPlayer()
 // 清空视频列表显示——————
 void PlayVideoUI::clearVideoList()
 {
-    // 删除所有视频小部件
-    QLayoutItem *child;
-    QGridLayout *layout = ui->videoListLayout;
-    //QGridLayout.takeAt()移除布局项
-    while ((child = layout->takeAt(0)) != nullptr) {
-        delete child->widget();
-        delete child;
+    // 清空模型，同时取消所有缩略图请求
+    videoListModel->clear();
+    nextCatalogCursor.clear();
+    catalogTotal = -1;
+}
+
+// 两次滚动的位移除以间隔，做一次平滑；停顿较久后重新开始计算
+void PlayVideoUI::onVideoListScrolled(int value)
+{
+    qint64 elapsed = scrollTimer.isValid() ? scrollTimer.restart() : 0;
+    if (!scrollTimer.isValid()) scrollTimer.start();
+
+    if (elapsed <= 0 || elapsed > kScrollSettleMs) {
+        scrollVelocity = 0;
+    } else {
+        double velocity = (value - lastScrollValue) * 1000.0 / elapsed;
+        scrollVelocity = 0.5 * scrollVelocity + 0.5 * velocity;
+    }
+    lastScrollValue = value;
+    scrollSettleTimer.start();
+    updateThumbnailViewport();
+}
+
+// 预取范围：静止时视口上下各一屏；滚动时前方按速度预取约1秒会滚到的内容（一到三屏），后方只留半屏
+// 优先级为与视口的距离，后方的距离加倍；范围外的视频项取消请求、丢弃像素，内存只与视口大小有关
+// 单元格按行排列，位置随行号单调增加，二分查找范围的起点，只遍历范围内的视频
+void PlayVideoUI::updateThumbnailViewport()
+{
+    QListView *view = ui->videoListView;
+    const int count = videoListModel->rowCount();
+    if (count == 0) return;
+
+    const int height = view->viewport()->height();
+    const bool moving = qAbs(scrollVelocity) > 50;
+    const int ahead = qBound(height, static_cast<int>(qAbs(scrollVelocity)), 3 * height);
+    const int behind = moving ? height / 2 : height;
+    const bool down = scrollVelocity >= 0;
+    const int above = down ? behind : ahead;
+    const int below = down ? ahead : behind;
+
+    const QRect visibleRect = view->viewport()->rect();
+    const QRect nearRect = visibleRect.adjusted(0, -above, 0, below);
+
+    QHash<int, int> priorities;
+    for (int row = firstRowBelow(nearRect.top()); row < count; ++row) {
+        QRect itemRect = view->visualRect(videoListModel->index(row));
+        if (itemRect.top() > nearRect.bottom()) break;
+
+        int priority = 0;
+        if (itemRect.bottom() < visibleRect.top()) {
+            priority = visibleRect.top() - itemRect.bottom();
+            if (moving && down) priority *= 2;
+        } else if (itemRect.top() > visibleRect.bottom()) {
+            priority = itemRect.top() - visibleRect.bottom();
+            if (moving && !down) priority *= 2;
+        }
+        priorities.insert(row, priority);
     }
+    videoListModel->setNearRows(priorities);
+
+    fetchMoreVideos();
+}
+
+// 视口坐标中底边不在y之上的第一个视频项，没有时返回行数；visualRect已减去滚动位置
+int PlayVideoUI::firstRowBelow(int y) const
+{
+    QListView *view = ui->videoListView;
+    int low = 0, high = videoListModel->rowCount();
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (view->visualRect(videoListModel->index(middle)).bottom() >= y) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return low;
 }
 
 // 处理返回视频列表事件
@@ -202,26 +413,46 @@ void PlayVideoUI::onReturnToListClicked()
     ui->statusLabel->setText("已返回视频列表");
 }
 
-// 处理选择上传视频文件事件
+// 处理选择上传视频文件事件，可以一次选择多个文件
 void PlayVideoUI::onUploadVideoSelected()
 {
-    QString fileName = QFileDialog::getOpenFileName(this,
-                                                    "选择视频文件",
-                                                    "",
-                                                    "视频文件 (*.mp4 *.avi *.mov *.mkv *.wmv *.flv *.webm)");
-
-    if (!fileName.isEmpty()) {
-        ui->selectedVideoPath->setText(fileName);
-        currentUploadFilePath = fileName;
+    QStringList fileNames = QFileDialog::getOpenFileNames(this,
+                                                          "选择视频文件",
+                                                          "",
+                                                          "视频文件 (*.mp4 *.avi *.mov *.mkv *.wmv *.flv *.webm)");
+
+    if (!fileNames.isEmpty()) {
+        selectedUploadFiles = fileNames;
+        ui->selectedVideoPath->setText(fileNames.size() == 1 ? fileNames.first()
+                                                             : QString("已选择 %1 个视频文件").arg(fileNames.size()));
         ui->uploadButton->setEnabled(true);
-        ui->statusLabel->setText("已选择视频文件: " + QFileInfo(fileName).fileName());
+        ui->statusLabel->setText(fileNames.size() == 1 ? "已选择视频文件: " + QFileInfo(fileNames.first()).fileName()
+                                                       : QString("已选择 %1 个视频文件").arg(fileNames.size()));
     }
 }
 
-// 处理上传视频按钮点击事件
+// 选择文件夹，上传其中（含子文件夹）的所有视频
+void PlayVideoUI::onUploadFolderSelected()
+{
+    QString folderPath = QFileDialog::getExistingDirectory(this, "选择要上传的文件夹");
+    if (folderPath.isEmpty()) return;
+
+    QStringList fileNames = UploadManager::listVideoFiles(folderPath, true);
+    if (fileNames.isEmpty()) {
+        QMessageBox::information(this, "提示", "该文件夹中没有视频文件");
+        return;
+    }
+
+    selectedUploadFiles = fileNames;
+    ui->selectedVideoPath->setText(QString("%1（%2 个视频文件）").arg(folderPath).arg(fileNames.size()));
+    ui->uploadButton->setEnabled(true);
+    ui->statusLabel->setText(QString("已选择 %1 个视频文件").arg(fileNames.size()));
+}
+
+// 处理上传视频按钮点击事件：选中的文件全部加入上传队列
 void PlayVideoUI::onUploadClicked()
 {
-    if (currentUploadFilePath.isEmpty()) {
+    if (selectedUploadFiles.isEmpty()) {
         QMessageBox::warning(this, "警告", "请先选择视频文件");
         return;
     }
@@ -230,89 +461,105 @@ void PlayVideoUI::onUploadClicked()
         return;
     }
 
-    // 准备上传请求——————QHttpMultiPart.prepare()准备multipart请求
-    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType, this);
+    // 分块上传，断线后自动重试，中断后再次上传同一文件会从已上传的位置继续
+    int added = uploadManager->enqueueFiles(selectedUploadFiles);
 
-    // 添加视频文件——————
-    QHttpPart videoPart;
-    videoPart.setHeader(QNetworkRequest::ContentDispositionHeader,
-                        QVariant("form-data; name=\"video\"; filename=\"" + QFileInfo(currentUploadFilePath).fileName()
-                                 + "\""));
+    // 清空当前选择
+    selectedUploadFiles.clear();
+    ui->selectedVideoPath->clear();
+    ui->uploadButton->setEnabled(false);
 
-    QFile *file = new QFile(currentUploadFilePath);
-    if (!file->open(QIODevice::ReadOnly)) {
-        QMessageBox::critical(this, "错误", "无法打开视频文件: " + file->errorString());
-        delete file;
-        delete multiPart;
+    if (added == 0) {
+        ui->statusLabel->setText("所选视频已在上传队列中");
         return;
     }
+    ui->statusLabel->setText(QString("已加入上传队列: %1 个视频").arg(added));
+}
 
-    videoPart.setBodyDevice(file);
-    file->setParent(multiPart); // 让 QHttpMultiPart 管理文件的生命周期
-
-    multiPart->append(videoPart);
-
-    // 构建上传URL
-    QUrl uploadUrl(serverAddress + "/upload");
-    QNetworkRequest request(uploadUrl);
+// 监视文件夹：之后放入的视频写入完成后自动上传
+void PlayVideoUI::onWatchFolderToggled(bool checked)
+{
+    if (!checked) {
+        uploadManager->setWatchFolder(QString());
+        ui->watchFolderButton->setToolTip(QString());
+        ui->statusLabel->setText("已停止监视文件夹");
+        return;
+    }
 
-    // 发送POST请求
-    QNetworkReply *reply = networkManager->post(request, multiPart);
-    multiPart->setParent(reply); // 让 QNetworkReply 管理 QHttpMultiPart 的生命周期
+    QString folderPath = QFileDialog::getExistingDirectory(this, "选择要监视的文件夹");
+    if (folderPath.isEmpty() || !uploadManager->setWatchFolder(folderPath)) {
+        if (!folderPath.isEmpty()) { QMessageBox::warning(this, "警告", "无法监视该文件夹"); }
+        QSignalBlocker blocker(ui->watchFolderButton);
+        ui->watchFolderButton->setChecked(false);
+        return;
+    }
 
-    // 连接上传完成信号
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        // 检查是否是上传请求的回复
-        if (reply->url().toString().contains("/upload")) { onVideoUploaded(reply); }
-        reply->deleteLater();
-    });
+    ui->watchFolderButton->setToolTip("监视中: " + uploadManager->getWatchFolder());
+    ui->statusLabel->setText(serverAddress.isEmpty() ? "正在监视文件夹，连接服务器后开始上传"
+                                                     : "正在监视文件夹，新放入的视频将自动上传");
+}
 
-    ui->statusLabel->setText("正在上传视频...");
+// 显示上传列表窗口
+void PlayVideoUI::onUploadListButtonClicked()
+{
+    if (!uploadDialog) { uploadDialog = new UploadManagerDialog(uploadManager, this); }
+    uploadDialog->show();
+    uploadDialog->raise();
+    uploadDialog->activateWindow();
 }
 
-// 处理视频上传完成响应
-void PlayVideoUI::onVideoUploaded(QNetworkReply *reply)
+// 上传队列状态变化：在状态栏显示汇总进度、总速度和剩余时间
+void PlayVideoUI::onUploadStatsChanged()
 {
-    if (reply->error() != QNetworkReply::NoError) {
-        ui->statusLabel->setText("上传失败: " + reply->errorString());
-        QMessageBox::critical(this, "错误", "视频上传失败:\n" + reply->errorString());
-        return;
+    int running = uploadManager->getRunningCount();
+    int analyzing = uploadManager->getAnalyzingCount();
+    if (running == 0 && analyzing == 0) return;
+
+    qint64 sent = 0;
+    qint64 total = 0;
+    const QList<UploadItem> items = uploadManager->getItems();
+    for (const UploadItem &item : items) {
+        if (item.isActive()) {
+            sent += item.bytesSent;
+            total += item.bytesTotal;
+        }
     }
+    if (total > 0) { ui->progressBar->setValue(static_cast<int>(sent * 100 / total)); }
+
+    ui->statusLabel->setText(QString("上传中 %1 个，分析中 %2 个，排队 %3 个，%4，剩余 %5")
+                                 .arg(running)
+                                 .arg(analyzing)
+                                 .arg(uploadManager->getQueuedCount())
+                                 .arg(DownloadManagerDialog::formatSpeed(uploadManager->getTotalSpeed()))
+                                 .arg(UploadManagerDialog::formatDuration(uploadManager->getEtaSeconds())));
+}
 
-    // 读取响应数据，QNetworkReply.readAll()读取响应数据
-    QByteArray responseData = reply->readAll();
+// 单个上传结束
+void PlayVideoUI::onUploadFinished(int id, bool success)
+{
+    const UploadItem *item = uploadManager->getItem(id);
+    if (!item) return;
 
-    // 解析响应，QJsonDocument.fromJson()解析JSON响应
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(responseData);
-    if (!jsonDoc.isObject()) {
-        ui->statusLabel->setText("上传响应格式错误");
+    if (!success) {
+        // 已上传的块保留在服务器上，重试时继续
+        ui->statusLabel->setText(QString("上传失败: %1（%2），可在上传列表中重试").arg(item->name, item->errorString));
         return;
     }
 
-    // QJsonObject.operator[]()获取响应字段
-    QJsonObject jsonObj = jsonDoc.object();
-    if (jsonObj["success"].toBool()) {
-        QString filename = jsonObj["filename"].toString();
-
-        // 显示上传成功消息
-        ui->statusLabel->setText("视频上传成功！");
-
-        // 清空当前选择
-        ui->selectedVideoPath->clear();
-        currentUploadFilePath.clear();
-        ui->uploadButton->setEnabled(false);
-
-        //QTimer.singleShot()延时刷新视频列表
-        // 设置定时器，2秒后更新状态并刷新视频列表
-        QTimer::singleShot(2000, this, [this]() {
-            ui->statusLabel->setText("准备连接服务器..."); // 恢复原始文本
-            loadVideoList();                               // 刷新视频列表
-        });
+    // 显示上传成功消息；服务器已有的部分没有重复上传
+    if (item->bytesSkipped >= item->bytesTotal && item->bytesTotal > 0) {
+        ui->statusLabel->setText(QString("服务器上已有相同的视频: %1").arg(item->name));
+    } else if (item->bytesSkipped > 0) {
+        ui->statusLabel->setText(QString("视频上传成功: %1（%2% 的数据服务器上已有）")
+                                     .arg(item->name)
+                                     .arg(item->bytesSkipped * 100 / qMax<qint64>(1, item->bytesTotal)));
     } else {
-        QString errorMsg = jsonObj["error"].toString();
-        ui->statusLabel->setText("上传失败: " + errorMsg);
-        QMessageBox::critical(this, "错误", "视频上传失败:\n" + errorMsg);
+        ui->statusLabel->setText(QString("视频上传成功: %1").arg(item->name));
     }
+
+    //QTimer.singleShot()延时刷新视频列表
+    // 设置定时器，2秒后刷新视频列表
+    QTimer::singleShot(2000, this, [this]() { loadVideoList(); });
 }
 
 // 转发连接按钮点击事件
@@ -324,10 +571,8 @@ void PlayVideoUI::onConnectButtonClicked()
 // 处理来自网络的视频列表响应
 void PlayVideoUI::onVideoListReceivedFromNetwork(QNetworkReply *reply)
 {
-    // 只处理视频列表请求
-    QString url = reply->url().toString();//获取请求URL
-    //contains()判断是否为视频列表请求
-    if (url.contains("/videos")) { onVideoListReceived(reply); }    //onVideoListReceived()处理视频列表数据
+    // 只处理视频列表请求；按请求时的标记判断，播放地址 /video/s... 也包含 "/videos"
+    if (reply->property("catalogRequest").toBool()) { onVideoListReceived(reply); }    //onVideoListReceived()处理视频列表数据
 
 }
 
@@ -382,10 +627,10 @@ void PlayVideoUI::onUploadButtonClicked()
 // 处理视频下载事件
 void PlayVideoUI::onVideoDownloadClicked(int index)
 {
-    if (index < 0 || index >= videoDownloadUrls.size()) { return; }
+    if (index < 0 || index >= videoListModel->rowCount()) { return; }
 
-    QString videoName = videoList[index].first;
-    QString downloadUrl = videoDownloadUrls[index];
+    QString videoName = videoListModel->getVideo(index).name;
+    QString downloadUrl = videoListModel->getVideo(index).downloadUrl;
 
     // 确保下载URL不是空的
     if (downloadUrl.isEmpty()) {
@@ -404,12 +649,13 @@ void PlayVideoUI::onVideoDownloadClicked(int index)
         return; // 用户取消了保存
     }
 
-    // 开始下载
+    // 加入下载队列
     ui->statusLabel->setText(QString("正在下载: %1").arg(videoName));
     downloadVideo(downloadUrl, savePath);
 }
 
 // 下载指定URL的视频文件
+// 加入下载队列，由DownloadManager按并发上限和优先级调度
 void PlayVideoUI::downloadVideo(const QString &downloadUrl, const QString &savePath)
 {
     // 构造完整的下载URL
@@ -419,75 +665,77 @@ void PlayVideoUI::downloadVideo(const QString &downloadUrl, const QString &saveP
         url = QUrl(serverAddress + downloadUrl);
     }
 
-    QNetworkRequest request(url);
+    downloadManager->enqueue(QFileInfo(savePath).fileName(), url, savePath);
 
-    // 发送GET请求下载文件
-    QNetworkReply *reply = networkManager->get(request);
+    if (downloadManager->getRunningCount() >= downloadManager->getMaxConcurrent()) {
+        ui->statusLabel->setText(QString("已加入下载队列，前面还有 %1 个下载").arg(downloadManager->getQueuedCount() - 1));
+    }
+}
+
+// 下载队列状态变化：进度条显示所有正在进行的下载的总进度
+void PlayVideoUI::onDownloadStatsChanged()
+{
+    int running = downloadManager->getRunningCount();
+    if (running == 0) return;
+
+    qint64 received = 0;
+    qint64 total = 0;
+    const QList<DownloadItem> items = downloadManager->getItems();
+    for (const DownloadItem &item : items) {
+        if (item.state == DownloadItem::Running && item.bytesTotal > 0) {
+            received += item.bytesReceived;
+            total += item.bytesTotal;
+        }
+    }
+    if (total > 0) { ui->progressBar->setValue(static_cast<int>(received * 100 / total)); }
+
+    ui->statusLabel->setText(QString("下载中 %1 个，排队 %2 个，%3")
+                                 .arg(running)
+                                 .arg(downloadManager->getQueuedCount())
+                                 .arg(DownloadManagerDialog::formatSpeed(downloadManager->getTotalSpeed())));
+}
+
+// 单个下载结束
+void PlayVideoUI::onDownloadFinished(int id, bool success)
+{
+    const DownloadItem *item = downloadManager->getItem(id);
+    if (!item) return;
 
-    // 创建文件用于保存
-    QFile *file = new QFile(savePath);
-    if (!file->open(QIODevice::WriteOnly)) {
-        ui->statusLabel->setText("无法创建文件");
-        QMessageBox::critical(this, "错误", "无法创建文件");
-        delete file;
+    if (!success) {
+        ui->statusLabel->setText(QString("下载失败: %1（%2），可在下载列表中重试").arg(item->name, item->errorString));
         return;
     }
 
-    // 连接下载进度信号
-    connect(reply, &QNetworkReply::downloadProgress, this, [this](qint64 bytesReceived, qint64 bytesTotal) {
-        if (bytesTotal > 0) {
-            int progress = (bytesReceived * 100) / bytesTotal;
-            ui->progressBar->setValue(progress);
-            ui->statusLabel->setText(QString("下载进度: %1%%").arg(progress));
-        }
-    });
+    ui->statusLabel->setText("下载完成: " + item->name);
 
-    // 连接下载完成信号
-    connect(reply, &QNetworkReply::finished, this, [this, reply, file, savePath]() {
-        if (reply->error() != QNetworkReply::NoError) {
-            ui->statusLabel->setText("下载失败: " + reply->errorString());
-            QMessageBox::critical(this, "下载失败", reply->errorString());
-            file->close();
-            file->deleteLater();
-            reply->deleteLater();
-            return;
-        }
+    // 队列全部完成时才询问，批量下载时不逐个弹窗
+    if (downloadManager->getRunningCount() > 0 || downloadManager->getQueuedCount() > 0) return;
 
-        // 将数据写入文件
-        QByteArray data = reply->readAll();
-        if (file->write(data) != -1) {
-            file->close();
-            ui->statusLabel->setText("下载完成");
-            ui->progressBar->setValue(100);
-
-            // 询问是否打开文件所在文件夹
-            QMessageBox msgBox;
-            msgBox.setIcon(QMessageBox::Information);
-            msgBox.setText("视频下载完成");
-            msgBox.setInformativeText("是否打开文件所在文件夹？");
-            msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-            msgBox.setDefaultButton(QMessageBox::Yes);
-
-            int ret = msgBox.exec();
-            if (ret == QMessageBox::Yes) {
-                // 打开文件所在文件夹
-                QString folderPath = QFileInfo(savePath).absolutePath();
-                QDesktopServices::openUrl(QUrl::fromLocalFile(folderPath));
-            }
-        } else {
-            ui->statusLabel->setText("保存文件失败");
-            QMessageBox::critical(this, "错误", "保存文件失败");
-        }
+    ui->progressBar->setValue(100);
+    QString folderPath = QFileInfo(item->savePath).absolutePath();
 
-        file->deleteLater();
-        reply->deleteLater();
-    });
+    // 询问是否打开文件所在文件夹
+    QMessageBox msgBox;
+    msgBox.setIcon(QMessageBox::Information);
+    msgBox.setText("视频下载完成");
+    msgBox.setInformativeText("是否打开文件所在文件夹？");
+    msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+    msgBox.setDefaultButton(QMessageBox::Yes);
 
-    // 连接错误信号
-    connect(reply, &QNetworkReply::errorOccurred, this, [this](QNetworkReply::NetworkError error) {
-        ui->statusLabel->setText("下载失败");
-        ui->progressBar->setValue(0);
-    });
+    int ret = msgBox.exec();
+    if (ret == QMessageBox::Yes) {
+        // 打开文件所在文件夹
+        QDesktopServices::openUrl(QUrl::fromLocalFile(folderPath));
+    }
+}
+
+// 显示下载列表窗口
+void PlayVideoUI::onDownloadListButtonClicked()
+{
+    if (!downloadDialog) { downloadDialog = new DownloadManagerDialog(downloadManager, this); }
+    downloadDialog->show();
+    downloadDialog->raise();
+    downloadDialog->activateWindow();
 }
 
 // 触发视频下载请求
@@ -507,7 +755,7 @@ void PlayVideoUI::emitDownloadRequested()
                                                         "视频文件 (*.mp4);;所有文件 (*.*)");
 
         if (!savePath.isEmpty()) {
-            // 开始下载
+            // 加入下载队列
             ui->statusLabel->setText(QString("正在下载: %1").arg(videoName));
             downloadVideo(downloadUrl, savePath);
         }
@@ -517,29 +765,73 @@ void PlayVideoUI::emitDownloadRequested()
 }
 
 // 加载视频列表
-void PlayVideoUI::loadVideoList()
+void PlayVideoUI::loadVideoList(int count)
+{
+    ++catalogGeneration;
+    catalogRefreshing = true;
+    refreshTarget = qMax(count, 1);
+    refreshVideos.clear();
+    refreshCursor.clear();
+    thumbnailLoader->revalidate(); // 列表刷新后缩略图可能已在服务器上更新
+
+    requestCatalogPage(QString(), qBound(kCatalogPageSize, refreshTarget, kMaxCatalogPageSize));
+}
+
+void PlayVideoUI::requestCatalogPage(const QString &cursor, int limit)
 {
     QUrl url(serverAddress + "/videos");
+    QUrlQuery query;
+    query.addQueryItem("limit", QString::number(limit));
+    if (!cursor.isEmpty()) { query.addQueryItem("cursor", cursor); }
+    url.setQuery(query);
     QNetworkRequest request(url);
 
     // 设置请求头————
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
 
+    // 之前的请求先置空再中止，中止时发出的finished不会被当作当前请求处理
+    if (QNetworkReply *previous = catalogReply) {
+        catalogReply = nullptr;
+        previous->abort();
+    }
+
     // 发送GET请求
-    networkManager->get(request);
+    catalogLoading = true;
+    catalogReply = networkManager->get(request);
+    catalogReply->setProperty("catalogRequest", true);
+}
+
+// 视口下方剩余不足一页时请求下一页，加载始终比滚动位置提前约一页
+void PlayVideoUI::fetchMoreVideos()
+{
+    if (catalogLoading || nextCatalogCursor.isEmpty()) return;
+
+    const int belowViewport = videoListModel->rowCount() - firstRowBelow(ui->videoListView->viewport()->height());
+    if (belowViewport > kCatalogPageSize) return;
+
+    requestCatalogPage(nextCatalogCursor, kCatalogPageSize);
+}
+
+void PlayVideoUI::showCatalogStatus()
+{
+    const int count = catalogTotal >= 0 ? catalogTotal : videoListModel->rowCount();
+    if (count == 0) {
+        ui->statusLabel->setText("服务器上没有找到视频");
+    } else {
+        ui->statusLabel->setText(QString("找到 %1 个视频").arg(count));
+    }
 }
 
 // 处理视频选择事件
 void PlayVideoUI::onVideoSelected(int index)
 {
-    if (index < 0 || index >= videoList.size()) { return; }
+    if (index < 0 || index >= videoListModel->rowCount()) { return; }
 
     // 获取选择的视频 URL
-    QString videoUrl = serverAddress + videoList[index].second;
+    QString videoUrl = serverAddress + videoListModel->getVideo(index).url;
 
     // 获取对应的下载 URL
-    QString downloadUrl;
-    if (index < videoDownloadUrls.size()) { downloadUrl = videoDownloadUrls[index]; }
+    QString downloadUrl = videoListModel->getVideo(index).downloadUrl;
 
     // 使用PlayVideo控制器设置视频源
     playVideoController->setVideoSource(QUrl(videoUrl));
@@ -553,7 +845,7 @@ void PlayVideoUI::onVideoSelected(int index)
     ui->stopButton->setEnabled(true);
 
     // 更新状态
-    // ui->playerStatusLabel->setText("已选择: " + videoList[index].first);  // 已删除的组件
+    // ui->playerStatusLabel->setText("已选择: " + videoListModel->getVideo(index).name);  // 已删除的组件
 
     // 显示视频播放界面
     showVideoPlayer();
@@ -562,9 +854,20 @@ void PlayVideoUI::onVideoSelected(int index)
 // 处理接收视频列表响应
 void PlayVideoUI::onVideoListReceived(QNetworkReply *reply)
 {
+    // 只处理最新的列表请求，重新连接或刷新后旧的响应直接丢弃
+    if (reply != catalogReply) {
+        reply->deleteLater();
+        return;
+    }
+    catalogReply = nullptr;
+
     if (reply->error() != QNetworkReply::NoError) {
+        catalogLoading = false;
+        catalogRefreshing = false;
         ui->statusLabel->setText("连接服务器失败: " + reply->errorString());
-        QMessageBox::critical(this, "错误", "无法连接到服务器:\n" + reply->errorString());
+        if (videoListModel->rowCount() == 0) {
+            QMessageBox::critical(this, "错误", "无法连接到服务器:\n" + reply->errorString());
+        }
         reply->deleteLater();
         return;
     }
@@ -573,93 +876,106 @@ void PlayVideoUI::onVideoListReceived(QNetworkReply *reply)
     QByteArray responseData = reply->readAll();
     reply->deleteLater();
 
-    // 解析 JSON
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(responseData);
-    if (!jsonDoc.isObject()) {
-        ui->statusLabel->setText("服务器响应格式错误");
-        return;
-    }
+    // 解析在工作线程中进行，一页之内也可能有几百个视频
+    const quint64 generation = catalogGeneration;
+    catalogPool.start([this, responseData, generation, address = serverAddress]() {
+        CatalogPage page = parseVideoList(responseData, address);
+        QMetaObject::invokeMethod(this, [this, page, generation]() {
+            if (generation != catalogGeneration) return;
+            if (!page.errorString.isEmpty()) {
+                catalogLoading = false;
+                catalogRefreshing = false;
+                ui->statusLabel->setText(page.errorString);
+                return;
+            }
+            if (page.total >= 0) catalogTotal = page.total;
+            onCatalogPageParsed(page.videos, page.nextCursor);
+        }, Qt::QueuedConnection);
+    });
+}
 
-    QJsonObject jsonObj = jsonDoc.object();
-    if (!jsonObj.contains("videos") || !jsonObj["videos"].isArray()) {
-        ui->statusLabel->setText("未找到视频列表");
+void PlayVideoUI::onCatalogPageParsed(const QList<VideoListModel::Video> &videos, const QString &nextCursor)
+{
+    // 滚动加载的下一页接在末尾
+    if (!catalogRefreshing) {
+        catalogLoading = false;
+        nextCatalogCursor = nextCursor;
+        videoListModel->appendVideos(videos);
+        showCatalogStatus();
+        fetchMoreVideos();
         return;
     }
 
-    QJsonArray videosArray = jsonObj["videos"].toArray();
-    clearVideoList();
-    videoList.clear();
-    videoDetails.clear();
-    videoDownloadUrls.clear(); // 清空下载URL列表
-
-    // 反转数组以使最新上传的视频显示在最前面
-    QList<QVariant> reversedVideos;
-    for (int i = videosArray.size() - 1; i >= 0; --i) {
-        reversedVideos.append(videosArray.at(i));
+    // 重新获取：从第一页取到不少于已加载的数量，或者取完为止
+    refreshVideos += videos;
+    refreshCursor = nextCursor;
+    if (!refreshCursor.isEmpty() && refreshVideos.size() < refreshTarget) {
+        requestCatalogPage(refreshCursor, qBound(kCatalogPageSize, refreshTarget - int(refreshVideos.size()), kMaxCatalogPageSize));
+        return;
     }
 
-    // 添加到网格布局
-    int row = 0, col = 0;
-    const int maxCols = 6; // 每行最多6个视频项
-
-    for (int i = 0; i < reversedVideos.size(); ++i) {
-        QJsonValue value = reversedVideos[i].toJsonObject();
-        if (value.isObject()) {
-            QJsonObject videoObj = value.toObject();
-            QString name = videoObj["name"].toString();
-            QString url = videoObj["url"].toString();
-            QString downloadUrl = videoObj["download_url"].toString(); // 获取下载链接
-            QString author = videoObj["author"].toString();            // 假设服务器返回作者信息
-            QString thumbnail = videoObj["thumbnail"].toString();      // 假设服务器返回缩略图URL
-            
-            // 如果缩略图URL是相对路径，构建完整URL
-            if (!thumbnail.isEmpty() && thumbnail.startsWith("/")) {
-                thumbnail = serverAddress + thumbnail;
-            }
-
-            if (!name.isEmpty() && !url.isEmpty()) {
-                // 添加到视频列表
-                videoList.append(qMakePair(name, url));
-                videoDetails.append(qMakePair(name, author));
-                videoDownloadUrls.append(downloadUrl); // 添加到下载URL列表
-
-                // 创建视频项小部件：显示缩略图和名称
-                VideoItemWidget *videoItem = new VideoItemWidget(name, thumbnail, this);
-
-                // 设置鼠标悬停样式
-                videoItem->setCursor(Qt::PointingHandCursor);
-
-                // 连接点击信号：播放视频
-                connect(videoItem, &VideoItemWidget::clicked, this, [this, i]() { onVideoSelected(i); });
-
-                // 添加到网格布局
-                ui->videoListLayout->addWidget(videoItem, row, col);
-
-                // 更新行列索引
-                col++;
-                if (col >= maxCols) {
-                    col = 0;
-                    row++;
+    // 与已加载的列表比较，在工作线程中进行；没有取到末尾时，已加载部分中最后一个取到的视频之后的行保留，
+    // 继续使用原来的游标，上传一个视频后只需要取第一页
+    const QList<VideoListModel::Video> current = videoListModel->getVideos();
+    const quint64 revision = videoListModel->getRevision();
+    const QList<VideoListModel::Video> refreshed = std::exchange(refreshVideos, {});
+    const bool complete = refreshCursor.isEmpty();
+    const quint64 generation = catalogGeneration;
+    catalogPool.start([this, current, revision, refreshed, complete, generation]() {
+        QList<VideoListModel::Video> videos = refreshed;
+        bool keepTail = false;
+        if (!complete && !refreshed.isEmpty()) {
+            int last = int(current.size()) - 1;
+            while (last >= 0 && current.at(last).name != refreshed.last().name) --last;
+            if (last >= 0) {
+                QSet<QString> names;
+                for (const VideoListModel::Video &video : refreshed) names.insert(video.name);
+                for (int i = last + 1; i < current.size(); ++i) {
+                    if (!names.contains(current.at(i).name)) videos.append(current.at(i));
                 }
+                keepTail = true;
             }
         }
-    }
+        VideoListModel::Diff diff = VideoListModel::diff(current, videos);
+        QMetaObject::invokeMethod(this, [this, diff, revision, keepTail, generation]() {
+            if (generation != catalogGeneration) return;
+            catalogLoading = false;
+            catalogRefreshing = false;
+            if (!keepTail) nextCatalogCursor = refreshCursor;
+            applyVideoListDiff(diff, revision);
+            fetchMoreVideos();
+        }, Qt::QueuedConnection);
+    });
+}
 
-    // 重置所有列的拉伸因子
-    for (int i = 0; i < maxCols; ++i) {
-        ui->videoListLayout->setColumnStretch(i, 0);
-    }
-    
-    // 如果有视频，给最后一列设置拉伸因子，使所有内容左对齐
-    if (!videoList.isEmpty()) {
-        ui->videoListLayout->setColumnStretch(maxCols - 1, 1);
+// 只修改变化的行，其余行的缩略图保留
+// 已向下滚动时以视口顶部的视频为锚点，刷新后它仍在原来的位置；在最顶部时新上传的视频直接出现在前面
+void PlayVideoUI::applyVideoListDiff(const VideoListModel::Diff &diff, quint64 revision)
+{
+    QListView *view = ui->videoListView;
+    QScrollBar *scrollBar = view->verticalScrollBar();
+    int anchorRow = -1;
+    int anchorTop = 0;
+    if (scrollBar->value() > 0 && revision == videoListModel->getRevision()) {
+        anchorRow = firstRowBelow(0);
+        if (anchorRow < videoListModel->rowCount()) {
+            anchorTop = view->visualRect(videoListModel->index(anchorRow)).top();
+        } else {
+            anchorRow = -1;
+        }
     }
 
-    if (videoList.isEmpty()) {
-        ui->statusLabel->setText("服务器上没有找到视频");
-    } else {
-        ui->statusLabel->setText(QString("找到 %1 个视频").arg(videoList.size()));
+    videoListModel->applyDiff(diff, revision);
+
+    if (anchorRow >= 0) {
+        int row = diff.mapRow(anchorRow);
+        if (row >= 0) scrollBar->setValue(scrollBar->value() + view->visualRect(videoListModel->index(row)).top() - anchorTop);
     }
+
+    // 等视图算出各单元格的位置后再加载缩略图
+    QTimer::singleShot(0, this, &PlayVideoUI::updateThumbnailViewport);
+
+    showCatalogStatus();
 }
 
 // 处理刷新按钮点击事件
@@ -672,13 +988,9 @@ void PlayVideoUI::onRefreshButtonClicked()
 
     // 更新状态
     ui->statusLabel->setText("正在刷新视频列表...");
-    clearVideoList();
-    videoList.clear();
-    videoDetails.clear();
-    videoDownloadUrls.clear();
 
-    // 重新获取视频列表
-    loadVideoList();
+    // 重新获取已加载的部分
+    loadVideoList(videoListModel->rowCount());
 }
 
 // 格式化时间为 mm:ss 格式
@@ -23,6 +23,11 @@
 #include <QPixmap>
 #include <QPainter>
 #include <QNetworkRequest>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QThreadPool>
+#include <QPointer>
+#include "videolistmodel.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -33,95 +38,11 @@ QT_END_NAMESPACE
 class Video;
 class DownloadVideoWidget;
 class PlayVideo;
-
-// 自定义视频项控件，显示缩略图和名称
-class VideoItemWidget : public QWidget
-{
-    Q_OBJECT
-
-public:
-    explicit VideoItemWidget(const QString &name, const QString &thumbnail, QWidget *parent = nullptr)
-        : QWidget(parent)
-        , m_name(name)
-        , m_thumbnail(thumbnail)
-    {
-        setFixedSize(120, 120); // 增加高度以容纳名称
-
-        QVBoxLayout *layout = new QVBoxLayout(this);
-        layout->setSpacing(5);
-        layout->setContentsMargins(2, 2, 2, 2);
-
-        m_thumbnailLabel = new QLabel(this);
-        m_thumbnailLabel->setFixedSize(116, 90);
-        m_thumbnailLabel->setStyleSheet("border: 1px solid gray; background-color: lightgray;");
-        m_thumbnailLabel->setAlignment(Qt::AlignCenter);
-
-        m_nameLabel = new QLabel(name, this);
-        m_nameLabel->setWordWrap(true);
-        m_nameLabel->setAlignment(Qt::AlignCenter);
-        m_nameLabel->setStyleSheet("font-size: 9px; color: black;");
-
-        layout->addWidget(m_thumbnailLabel);
-        layout->addWidget(m_nameLabel);
-
-        setCursor(Qt::PointingHandCursor);
-
-        // 如果有缩略图URL，则加载图片，否则显示占位符
-        if (!thumbnail.isEmpty()) {
-            m_thumbnailLabel->setText(""); // 先清空文本，等待图片加载
-            loadImage(thumbnail);
-        } else {
-            m_thumbnailLabel->setText("视频");
-        }
-    }
-
-    void loadImage(const QString &imageUrl) {
-        // 创建网络请求获取缩略图
-        QNetworkAccessManager *manager = new QNetworkAccessManager(this);
-        connect(manager, &QNetworkAccessManager::finished, this, [this, manager](QNetworkReply *reply) {
-            if (reply->error() == QNetworkReply::NoError) {
-                QPixmap pixmap;
-                pixmap.loadFromData(reply->readAll());
-                if (!pixmap.isNull()) {
-                    // 缩放图片以适应标签
-                    QPixmap scaledPixmap = pixmap.scaled(
-                        m_thumbnailLabel->size(), 
-                        Qt::KeepAspectRatio, 
-                        Qt::SmoothTransformation
-                    );
-                    m_thumbnailLabel->setPixmap(scaledPixmap);
-                    m_thumbnailLabel->setText(""); // 清除文本
-                } else {
-                    m_thumbnailLabel->setText("视频");
-                }
-            } else {
-                m_thumbnailLabel->setText("视频");
-            }
-            reply->deleteLater();
-            manager->deleteLater();
-        });
-
-        QNetworkRequest request;
-        request.setUrl(QUrl(imageUrl));
-        manager->get(request);
-    }
-
-signals:
-    void clicked();
-
-protected:
-    void mousePressEvent(QMouseEvent *event) override
-    {
-        if (event->button() == Qt::LeftButton) { emit clicked(); }
-        QWidget::mousePressEvent(event);
-    }
-
-private:
-    QString m_name;
-    QString m_thumbnail;
-    QLabel *m_thumbnailLabel;
-    QLabel *m_nameLabel;
-};
+class DownloadManager;
+class DownloadManagerDialog;
+class UploadManager;
+class UploadManagerDialog;
+class ThumbnailLoader;
 
 class PlayVideoUI : public QMainWindow
 {
@@ -140,8 +61,9 @@ private slots:
     void onVideoSelected(int index = -1);//选择视频
     void onReturnToListClicked();//返回视频列表
     void onUploadClicked();//上传视频
-    void onUploadVideoSelected();//选择要上传的视频
-    void onVideoUploaded(QNetworkReply *reply);//视频上传完成
+    void onUploadVideoSelected();//选择要上传的视频（可多选）
+    void onUploadFolderSelected();//上传整个文件夹
+    void onWatchFolderToggled(bool checked);//开始或停止监视文件夹
     void onVideoDownloadClicked(int index);//下载视频
     void onConnectButtonClicked();//连接按钮点击
     void onVideoListReceivedFromNetwork(QNetworkReply *reply); //网络收到视频列表
@@ -154,24 +76,55 @@ private slots:
     void onBrowseButtonClicked();
     void onUploadButtonClicked();
     void onRefreshButtonClicked();
+    void onDownloadListButtonClicked();//显示下载列表
+    void onDownloadStatsChanged();//下载队列状态变化
+    void onDownloadFinished(int id, bool success);//单个下载结束
+    void onUploadListButtonClicked();//显示上传列表
+    void onUploadStatsChanged();//上传队列状态变化
+    void onUploadFinished(int id, bool success);//单个上传结束
     // void onProgressSliderChanged();  // 已被lambda函数替代
 
 private:
-    void loadVideoList();//加载视频列表
+    void loadVideoList(int count = 0);//从第一页重新获取至少count个视频（至少一页），与已加载的列表比较后只修改变化的部分
+    void requestCatalogPage(const QString &cursor, int limit);//请求一页视频列表，cursor为空时从最新的视频开始
+    void onCatalogPageParsed(const QList<VideoListModel::Video> &videos, const QString &nextCursor);//收到一页视频
+    void fetchMoreVideos();//视口下方剩余不足一页时请求下一页
+    void showCatalogStatus();//显示视频数量
     void showVideoList();//显示视频列表界面
     void showVideoPlayer();//显示视频播放界面
     void clearVideoList();//清空视频列表
-    void downloadVideo(const QString &downloadUrl, const QString &filename);//下载视频
+    void onVideoListScrolled(int value);//估计滚动速度，更新预取范围
+    void updateThumbnailViewport();//预取范围内的视频项按距离加载缩略图，其余取消并丢弃像素
+    int firstRowBelow(int y) const;//视口坐标中底边不在y之上的第一个视频项
+    void applyVideoListDiff(const VideoListModel::Diff &diff, quint64 revision);//刷新时只修改变化的视频项
+    void downloadVideo(const QString &downloadUrl, const QString &savePath);//加入下载队列
     void emitDownloadRequested();//发出下载请求信号
 
     Ui::PlayVideoUI *ui;
     QNetworkAccessManager *networkManager;
     PlayVideo *playVideoController;
+    DownloadManager *downloadManager;            //下载队列
+    DownloadManagerDialog *downloadDialog;       //下载列表窗口
     QString serverAddress;                       //服务器地址
-    QList<QPair<QString, QString>> videoList;    //视频列表 (名称, URL)
-    QList<QPair<QString, QString>> videoDetails; //视频详细信息 (标题, 作者)
-    QString currentUploadFilePath;               //当前上传的文件路径
-    QList<QString> videoDownloadUrls;            //视频下载URL列表
+    QStringList selectedUploadFiles;             //已选择、尚未加入队列的文件
+    UploadManager *uploadManager;                //上传队列
+    UploadManagerDialog *uploadDialog;           //上传列表窗口
+    ThumbnailLoader *thumbnailLoader;            //所有视频项共用的缩略图加载服务
+    VideoListModel *videoListModel;              //视频列表（名称、URL、作者、下载URL、缩略图）
+    QThreadPool catalogPool;                     //解析视频列表并计算差异，单线程按收到的顺序完成
+    QPointer<QNetworkReply> catalogReply;        //正在进行的视频列表请求，发出新请求后旧的响应不再处理
+    quint64 catalogGeneration;                   //每次重新获取时加1，之前的解析结果到达后丢弃
+    QString nextCatalogCursor;                   //已加载部分之后下一页的游标，为空时已全部加载
+    bool catalogLoading;                         //正在请求、解析或合并视频列表
+    int catalogTotal;                            //服务器上的视频总数，旧服务器不提供时为-1
+    bool catalogRefreshing;                      //正在从第一页重新获取
+    int refreshTarget;                           //本次需要重新获取的视频数
+    QString refreshCursor;                       //重新获取期间下一页的游标
+    QList<VideoListModel::Video> refreshVideos;  //重新获取期间已收到的视频
+    int lastScrollValue;                         //上次滚动位置
+    QElapsedTimer scrollTimer;                   //距上次滚动的时间
+    double scrollVelocity;                       //视频列表滚动速度（像素/秒，向下为正）
+    QTimer scrollSettleTimer;                    //停止滚动一段时间后速度归零
 
     // 进度条相关组件
     QSlider *progressSlider;
@@ -0,0 +1,92 @@
+//posterextractor.cpp
+//解码在多媒体后端自己的线程中进行，这里只在收到目标位置的帧后转换和压缩一张小图
+
+#include "posterextractor.h"
+#include "imagescaler.h"
+#include <QBuffer>
+#include <QImage>
+#include <QMediaMetaData>
+#include <QUrl>
+
+PosterExtractor::PosterExtractor(QObject *parent)
+    : QObject(parent)
+    , m_player(new QMediaPlayer(this))
+    , m_sink(new QVideoSink(this))
+    , m_targetMs(0)
+    , m_done(false)
+{
+    // 不设置QAudioOutput，不会发出声音
+    m_player->setVideoSink(m_sink);
+    connect(m_player, &QMediaPlayer::mediaStatusChanged, this, &PosterExtractor::onMediaStatusChanged);
+    connect(m_sink, &QVideoSink::videoFrameChanged, this, &PosterExtractor::onVideoFrameChanged);
+
+    m_timeout.setSingleShot(true);
+    connect(&m_timeout, &QTimer::timeout, this, &PosterExtractor::finish);
+}
+
+void PosterExtractor::extract(const QString &filePath)
+{
+    m_timeout.start(kTimeoutMs);
+    m_player->setSource(QUrl::fromLocalFile(filePath));
+}
+
+void PosterExtractor::onMediaStatusChanged(QMediaPlayer::MediaStatus status)
+{
+    if (m_done) return;
+
+    if (status == QMediaPlayer::InvalidMedia) {
+        finish();
+        return;
+    }
+    if (status != QMediaPlayer::LoadedMedia) return;
+
+    qint64 duration = m_player->duration();
+    if (duration > 0) m_metadata["duration_ms"] = duration;
+    QSize resolution = m_player->metaData().value(QMediaMetaData::Resolution).toSize();
+    if (resolution.isValid()) {
+        m_metadata["width"] = resolution.width();
+        m_metadata["height"] = resolution.height();
+    }
+
+    if (!m_player->hasVideo()) {
+        finish();
+        return;
+    }
+
+    // 与服务器相同，取视频5%处，避开片头黑屏
+    m_targetMs = duration * 5 / 100;
+    m_player->setPosition(m_targetMs);
+    m_player->play();
+}
+
+void PosterExtractor::onVideoFrameChanged(const QVideoFrame &frame)
+{
+    if (m_done || !frame.isValid()) return;
+    // 跳转完成前可能还会送来开头的帧
+    if (frame.startTime() >= 0 && frame.startTime() / 1000 + 1000 < m_targetMs) return;
+
+    QImage image = frame.toImage();
+    if (image.isNull()) return;
+
+    if (!m_metadata.contains("width")) {
+        m_metadata["width"] = image.width();
+        m_metadata["height"] = image.height();
+    }
+
+    QBuffer buffer(&m_thumbnail);
+    buffer.open(QIODevice::WriteOnly);
+    if (!ImageScaler::downscale(image, kThumbnailSize).save(&buffer, "JPG", kJpegQuality)) {
+        m_thumbnail.clear();
+    }
+    finish();
+}
+
+void PosterExtractor::finish()
+{
+    if (m_done) return;
+    m_done = true;
+    m_timeout.stop();
+    m_sink->disconnect(this);
+    m_player->stop();
+    emit finished();
+}
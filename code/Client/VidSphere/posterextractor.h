@@ -0,0 +1,51 @@
+//posterextractor.h
+//上传前在客户端生成缩略图：不显示画面的QMediaPlayer把帧送到QVideoSink，取视频5%处的一帧缩放为320x180的JPEG
+//同时读出时长和分辨率，随视频一起上传，服务器不必再用OpenCV解码
+//无法解码或超时后也会发出finished，此时缩略图为空，由服务器自己生成
+
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QMediaPlayer>
+#include <QSize>
+#include <QTimer>
+#include <QVideoFrame>
+#include <QVideoSink>
+
+class PosterExtractor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PosterExtractor(QObject *parent = nullptr);
+
+    void extract(const QString &filePath);
+
+    bool isFinished() const { return m_done; }
+    QByteArray getThumbnail() const { return m_thumbnail; }  // JPEG，失败时为空
+    QJsonObject getMetadata() const { return m_metadata; }   // duration_ms、width、height
+
+signals:
+    void finished();
+
+private slots:
+    void onMediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void onVideoFrameChanged(const QVideoFrame &frame);
+
+private:
+    void finish();
+
+    static constexpr QSize kThumbnailSize{320, 180};  // 与服务器生成的缩略图一致
+    static constexpr int kTimeoutMs = 5000;
+    static constexpr int kJpegQuality = 85;
+
+    QMediaPlayer *m_player;
+    QVideoSink *m_sink;
+    QTimer m_timeout;
+    QByteArray m_thumbnail;
+    QJsonObject m_metadata;
+    qint64 m_targetMs;
+    bool m_done;
+};
@@ -0,0 +1,488 @@
+//segmenteddownload.cpp
+//分段下载：每个连接请求 Range: bytes=start-end 并把数据写到 .part 文件的对应偏移
+//空闲连接从预计完成时间最长的区间窃取后一半；每秒统计吞吐量，增加连接带来提升才继续增加
+
+#include "segmenteddownload.h"
+#include "downloadtask.h"
+#include <QFileInfo>
+#include <QNetworkRequest>
+
+SegmentedDownload::SegmentedDownload(QNetworkAccessManager *manager,
+                                     const QUrl &url,
+                                     const QString &savePath,
+                                     QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_probeReply(nullptr)
+    , m_singleTask(nullptr)
+    , m_file(DownloadJournal::partPath(savePath))
+    , m_url(url)
+    , m_savePath(savePath)
+    , m_totalSize(-1)
+    , m_targetConnections(kInitialConnections)
+    , m_maxConnections(kMaxConnections)
+    , m_lastThroughput(0)
+    , m_throughputBeforeGrowth(0)
+    , m_settleTicks(0)
+    , m_growthStopped(false)
+    , m_bytesSinceJournal(0)
+    , m_restarted(false)
+    , m_done(false)
+{
+    m_chunk.resize(kChunkSize);
+    m_tickTimer.setInterval(kTickMs);
+    connect(&m_tickTimer, &QTimer::timeout, this, &SegmentedDownload::onThroughputTick);
+    connect(&m_verifier, &DownloadVerifier::verified, this, &SegmentedDownload::onVerified);
+}
+
+SegmentedDownload::~SegmentedDownload()
+{
+    if (m_probeReply) {
+        m_probeReply->disconnect(this);
+        m_probeReply->abort();
+        m_probeReply->deleteLater();
+    }
+    if (!m_done && m_file.isOpen()) { saveJournal(); }
+    while (!m_segments.isEmpty()) { removeSegment(m_segments.first()); }
+}
+
+// 已完成的字节数 = 总大小 - 所有未完成区间
+qint64 SegmentedDownload::getBytesWritten() const
+{
+    if (m_singleTask) return m_singleTask->getBytesWritten();
+    if (m_totalSize < 0) return 0;
+
+    qint64 remaining = 0;
+    for (const Segment *segment : m_segments) { remaining += segment->end - segment->start; }
+    for (const auto &range : m_pendingRanges) { remaining += range.second - range.first; }
+    return m_totalSize - remaining;
+}
+
+// 设置连接数上限，超出的连接在完成当前区间后不再补充
+void SegmentedDownload::setMaxConnections(int count)
+{
+    m_maxConnections = qBound(1, count, kMaxConnections);
+    m_targetConnections = qMin(m_targetConnections, m_maxConnections);
+}
+
+// 单连接下载留下的日志直接交给DownloadTask续传，否则先用HEAD探测文件大小和Range支持
+bool SegmentedDownload::start()
+{
+    DownloadJournal saved;
+    if (saved.load(DownloadJournal::journalPath(m_savePath)) && saved.url == m_url.toString() && !saved.segmented) {
+        startSingleStream();
+        return true;
+    }
+
+    QNetworkRequest request(m_url);
+    m_probeReply = m_manager->head(request);
+    connect(m_probeReply, &QNetworkReply::finished, this, &SegmentedDownload::onProbeFinished);
+    return true;
+}
+
+// 取消下载
+void SegmentedDownload::abort()
+{
+    if (m_done) return;
+    if (m_singleTask) {
+        m_singleTask->abort();
+        return;
+    }
+    fail("下载已取消");
+}
+
+// HEAD返回：决定分段还是单连接
+void SegmentedDownload::onProbeFinished()
+{
+    QNetworkReply *reply = m_probeReply;
+    m_probeReply = nullptr;
+    reply->deleteLater();
+    if (m_done) return;
+
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    qint64 totalSize = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    bool acceptRanges = reply->rawHeader("Accept-Ranges").contains("bytes");
+
+    QString etag = QString::fromLatin1(reply->rawHeader("ETag"));
+    QString validator = (!etag.isEmpty() && !etag.startsWith("W/"))
+                            ? etag
+                            : QString::fromLatin1(reply->rawHeader("Last-Modified"));
+
+    // 探测失败时由单连接GET给出真正的错误信息
+    if (reply->error() != QNetworkReply::NoError || status != 200 || !acceptRanges
+        || validator.isEmpty() || totalSize < kMinSegmentedSize) {
+        startSingleStream();
+        return;
+    }
+
+    m_totalSize = totalSize;
+    m_validator = validator;
+
+    quint32 digest = 0;
+    if (DownloadVerifier::parseDigest(reply->rawHeader("X-Checksum-CRC32C"), &digest)) { m_verifier.setExpected(digest); }
+
+    // 日志中的文件版本和大小与服务器一致时续传未完成的区间
+    DownloadJournal saved;
+    bool resumable = saved.load(DownloadJournal::journalPath(m_savePath))
+                     && saved.segmented
+                     && saved.url == m_url.toString()
+                     && saved.validator == m_validator
+                     && saved.totalSize == m_totalSize
+                     && QFileInfo(m_file.fileName()).size() == m_totalSize;
+
+    if (!openPartFile(resumable ? &saved : nullptr)) {
+        fail("无法创建文件: " + m_file.errorString());
+        return;
+    }
+
+    m_windowTimer.start();
+    m_tickTimer.start();
+    fillIdleConnections();
+    if (!m_done) { saveJournal(); }
+}
+
+// 打开并预分配 .part 文件，新下载时把整个文件按初始连接数均分
+bool SegmentedDownload::openPartFile(const DownloadJournal *resume)
+{
+    if (resume) {
+        if (!m_file.open(QIODevice::ReadWrite)) return false;
+        m_pendingRanges = resume->pendingRanges;
+        return true;
+    }
+
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) return false;
+    if (!m_file.resize(m_totalSize)) return false;
+
+    m_pendingRanges.clear();
+    qint64 step = (m_totalSize / m_targetConnections) / kAlignment * kAlignment;
+    qint64 start = 0;
+    for (int i = 0; i < m_targetConnections - 1; ++i) {
+        m_pendingRanges.append(qMakePair(start, start + step));
+        start += step;
+    }
+    m_pendingRanges.append(qMakePair(start, m_totalSize));
+    return true;
+}
+
+// 退回单连接下载，信号原样转发
+void SegmentedDownload::startSingleStream()
+{
+    m_singleTask = new DownloadTask(m_manager, m_url, m_savePath, this);
+    connect(m_singleTask, &DownloadTask::progressChanged, this, &SegmentedDownload::progressChanged);
+    connect(m_singleTask, &DownloadTask::finished, this, [this](bool success) {
+        m_done = true;
+        m_errorString = m_singleTask->getErrorString();
+        emit finished(success);
+    });
+
+    if (!m_singleTask->start()) {
+        m_done = true;
+        m_errorString = m_singleTask->getErrorString();
+        QMetaObject::invokeMethod(this, [this]() { emit finished(false); }, Qt::QueuedConnection);
+    }
+}
+
+// 为区间 [start, end) 开一个连接
+void SegmentedDownload::startSegment(qint64 start, qint64 end, int retries)
+{
+    Segment *segment = new Segment;
+    segment->start = start;
+    segment->end = end;
+    segment->retries = retries;
+
+    QNetworkRequest request(m_url);
+    request.setRawHeader("Range", "bytes=" + QByteArray::number(start) + "-" + QByteArray::number(end - 1));
+    request.setRawHeader("If-Range", m_validator.toUtf8());
+
+    segment->reply = m_manager->get(request);
+    segment->reply->setReadBufferSize(kReadBufferSize);
+    connect(segment->reply, &QNetworkReply::readyRead, this, [this, segment]() { onSegmentReadyRead(segment); });
+    connect(segment->reply, &QNetworkReply::finished, this, [this, segment]() { onSegmentFinished(segment); });
+
+    m_segments.append(segment);
+}
+
+// 分段数据到达
+void SegmentedDownload::onSegmentReadyRead(Segment *segment)
+{
+    if (m_done) return;
+
+    // If-Range不匹配时服务器返回200和完整文件，说明文件已变化
+    int status = segment->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 200) {
+        restartFromScratch();
+        return;
+    }
+    if (status != 206) return; // 错误状态交给finished处理
+
+    if (!writeSegmentData(segment)) {
+        fail("写入文件失败: " + m_file.errorString());
+        return;
+    }
+
+    // 区间被窃取后可能提前写满，此时关闭连接并让它去接新的工作
+    if (segment->start >= segment->end) {
+        removeSegment(segment);
+        fillIdleConnections();
+        if (m_done) return;
+    }
+
+    if (m_bytesSinceJournal >= kJournalInterval) { saveJournal(); }
+    emit progressChanged(getBytesWritten(), m_totalSize);
+}
+
+// 把分段数据写到文件的对应偏移，不超过（可能已缩短的）区间上界
+bool SegmentedDownload::writeSegmentData(Segment *segment)
+{
+    while (segment->reply->bytesAvailable() > 0 && segment->start < segment->end) {
+        qint64 want = qMin(kChunkSize, segment->end - segment->start);
+        qint64 n = segment->reply->read(m_chunk.data(), want);
+        if (n <= 0) break;
+        if (!m_file.seek(segment->start) || m_file.write(m_chunk.constData(), n) != n) { return false; }
+        m_verifier.addData(segment->start, m_chunk.constData(), n);
+        segment->start += n;
+        segment->windowBytes += n;
+        m_bytesSinceJournal += n;
+    }
+    return true;
+}
+
+// 分段连接结束：写完则领取新工作，出错则重试剩余部分
+void SegmentedDownload::onSegmentFinished(Segment *segment)
+{
+    if (m_done) return;
+
+    int status = segment->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 200) {
+        restartFromScratch();
+        return;
+    }
+
+    bool ok = segment->reply->error() == QNetworkReply::NoError && status == 206;
+    if (status == 206 && !writeSegmentData(segment)) {
+        fail("写入文件失败: " + m_file.errorString());
+        return;
+    }
+
+    qint64 start = segment->start;
+    qint64 end = segment->end;
+    int retries = segment->retries;
+    QString errorString = segment->reply->errorString();
+    removeSegment(segment);
+
+    if (start < end) {
+        // 连接提前断开，剩余部分重新请求
+        if (retries >= kMaxRetries) {
+            fail(ok ? QString("服务器提前结束了分段传输") : errorString);
+            return;
+        }
+        startSegment(start, end, retries + 1);
+        return;
+    }
+
+    fillIdleConnections();
+}
+
+// 关闭并释放一个分段连接
+void SegmentedDownload::removeSegment(Segment *segment)
+{
+    m_segments.removeOne(segment);
+    if (segment->reply) {
+        segment->reply->disconnect(this);
+        if (segment->reply->isRunning()) { segment->reply->abort(); }
+        segment->reply->deleteLater();
+    }
+    delete segment;
+}
+
+// 补足目标连接数：先分配未领取的区间，再从慢连接窃取
+void SegmentedDownload::fillIdleConnections()
+{
+    while (m_segments.size() < m_targetConnections) {
+        if (!m_pendingRanges.isEmpty()) {
+            QPair<qint64, qint64> range = m_pendingRanges.takeFirst();
+            startSegment(range.first, range.second);
+            continue;
+        }
+        if (!stealWork()) break;
+    }
+
+    if (m_segments.isEmpty() && m_pendingRanges.isEmpty()) { finishDownload(); }
+}
+
+// 选出预计完成时间最长的区间，把它的后一半交给新连接
+bool SegmentedDownload::stealWork()
+{
+    Segment *victim = nullptr;
+    double worstEta = -1;
+    for (Segment *segment : m_segments) {
+        qint64 remaining = segment->end - segment->start;
+        if (remaining < 2 * kMinStealSize) continue;
+        double eta = remaining / qMax(segment->throughput, 1.0);
+        if (eta > worstEta) {
+            worstEta = eta;
+            victim = segment;
+        }
+    }
+    if (!victim) return false;
+
+    qint64 remaining = victim->end - victim->start;
+    qint64 mid = (victim->start + remaining / 2) / kAlignment * kAlignment;
+    if (mid <= victim->start) return false;
+
+    qint64 oldEnd = victim->end;
+    victim->end = mid;  // 原连接写到mid后自行关闭
+    startSegment(mid, oldEnd);
+    return true;
+}
+
+// 每秒统计各连接吞吐量，并根据总吞吐量的变化调整目标连接数
+void SegmentedDownload::onThroughputTick()
+{
+    double elapsed = m_windowTimer.restart() / 1000.0;
+    if (elapsed <= 0 || m_done) return;
+
+    double total = 0;
+    for (Segment *segment : m_segments) {
+        double current = segment->windowBytes / elapsed;
+        segment->throughput = segment->throughput > 0 ? 0.7 * segment->throughput + 0.3 * current : current;
+        segment->windowBytes = 0;
+        total += current;
+    }
+
+    if (!m_growthStopped) {
+        if (m_throughputBeforeGrowth > 0) {
+            // 新连接经过两个周期的慢启动后再评估，提升不足10%说明瓶颈不在连接数
+            if (++m_settleTicks >= 2) {
+                if (total < m_throughputBeforeGrowth * 1.10) {
+                    m_growthStopped = true;
+                    m_targetConnections = qMax(qMin(kInitialConnections, m_maxConnections), m_targetConnections - 1);
+                }
+                m_throughputBeforeGrowth = 0;
+            }
+        } else if (m_targetConnections < m_maxConnections && m_segments.size() >= m_targetConnections) {
+            m_throughputBeforeGrowth = qMax(total, m_lastThroughput);
+            m_settleTicks = 0;
+            m_targetConnections++;
+            fillIdleConnections();
+        }
+    }
+    m_lastThroughput = total;
+
+    if (!m_done && m_bytesSinceJournal > 0) { saveJournal(); }
+}
+
+// 记录所有未完成的区间
+void SegmentedDownload::saveJournal()
+{
+    if (!m_file.isOpen() || !m_file.flush()) return;
+
+    DownloadJournal journal;
+    journal.url = m_url.toString();
+    journal.validator = m_validator;
+    journal.totalSize = m_totalSize;
+    journal.segmented = true;
+    for (const Segment *segment : m_segments) {
+        if (segment->start < segment->end) { journal.pendingRanges.append(qMakePair(segment->start, segment->end)); }
+    }
+    journal.pendingRanges.append(m_pendingRanges);
+    journal.committed = getBytesWritten();
+    journal.save(DownloadJournal::journalPath(m_savePath));
+    m_bytesSinceJournal = 0;
+}
+
+// 所有区间完成：重命名为目标文件
+void SegmentedDownload::finishDownload()
+{
+    m_done = true;
+    m_tickTimer.stop();
+
+    if (!m_file.flush()) {
+        m_done = false;
+        fail("写入文件失败: " + m_file.errorString());
+        return;
+    }
+    m_file.close();
+
+    // 各分段的CRC在后台已经算好，这里只需拼接，续传前下载的区间从文件补读
+    if (m_verifier.hasExpected()) {
+        m_verifier.finish(m_file.fileName(), m_totalSize);
+        return;
+    }
+    renameToTarget();
+}
+
+// 校验不一致时删除 .part，重新下载
+void SegmentedDownload::onVerified(bool success)
+{
+    if (success) {
+        renameToTarget();
+        return;
+    }
+
+    m_file.remove();
+    DownloadJournal::remove(DownloadJournal::journalPath(m_savePath));
+    m_errorString = QString("文件校验失败（CRC32C %1），请重新下载").arg(m_verifier.getResult(), 8, 16, QChar('0'));
+    emit finished(false);
+}
+
+void SegmentedDownload::renameToTarget()
+{
+    if (QFile::exists(m_savePath)) { QFile::remove(m_savePath); }
+    if (!m_file.rename(m_savePath)) {
+        m_errorString = "无法保存文件: " + m_file.errorString();
+        emit finished(false);
+        return;
+    }
+    DownloadJournal::remove(DownloadJournal::journalPath(m_savePath));
+
+    emit progressChanged(m_totalSize, m_totalSize);
+    emit finished(true);
+}
+
+// 服务器文件在下载过程中发生变化：丢弃已下载内容重新开始（只重试一次）
+void SegmentedDownload::restartFromScratch()
+{
+    if (m_restarted) {
+        fail("服务器上的文件在下载过程中发生了变化");
+        return;
+    }
+    m_restarted = true;
+
+    m_tickTimer.stop();
+    while (!m_segments.isEmpty()) { removeSegment(m_segments.first()); }
+    m_pendingRanges.clear();
+    m_file.close();
+    m_file.remove();
+    DownloadJournal::remove(DownloadJournal::journalPath(m_savePath));
+
+    m_totalSize = -1;
+    m_validator.clear();
+    m_verifier.reset();
+    m_targetConnections = qMin(kInitialConnections, m_maxConnections);
+    m_throughputBeforeGrowth = 0;
+    m_growthStopped = false;
+    start();
+}
+
+// 失败：保存日志后关闭所有连接
+void SegmentedDownload::fail(const QString &message)
+{
+    if (m_done) return;
+    m_errorString = message;
+
+    if (m_probeReply) {
+        m_probeReply->disconnect(this);
+        m_probeReply->abort();
+        m_probeReply->deleteLater();
+        m_probeReply = nullptr;
+    }
+
+    m_tickTimer.stop();
+    if (m_file.isOpen()) { saveJournal(); }
+    m_done = true;
+    while (!m_segments.isEmpty()) { removeSegment(m_segments.first()); }
+    m_file.close();
+
+    emit finished(false);
+}
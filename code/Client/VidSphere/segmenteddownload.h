@@ -0,0 +1,118 @@
+//segmenteddownload.h
+//分段多连接下载：HEAD探测文件大小后把文件切成多个字节区间并行下载，各自写入预分配文件的对应偏移
+//慢连接的剩余区间会被空闲连接窃取一半，连接数根据实测总吞吐量自适应增减
+//服务器不支持Range或文件较小时退回单连接的DownloadTask
+
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QUrl>
+#include "downloadjournal.h"
+#include "downloadverifier.h"
+#include "networklimits.h"
+
+class DownloadTask;
+
+class SegmentedDownload : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SegmentedDownload(QNetworkAccessManager *manager,
+                               const QUrl &url,
+                               const QString &savePath,
+                               QObject *parent = nullptr);
+    ~SegmentedDownload();
+
+    bool start();  // 发出HEAD请求，之后的错误通过finished(false)报告
+    void abort();  // 取消下载，已下载区间记入日志以便续传
+
+    QUrl getUrl() const { return m_url; }
+    QString getSavePath() const { return m_savePath; }
+    QString getErrorString() const { return m_errorString; }
+    qint64 getBytesWritten() const;
+    int getConnectionCount() const { return m_segments.size(); }
+    void setMaxConnections(int count);  // 连接数上限，多个下载同时进行时由下载管理器分配
+
+signals:
+    void progressChanged(qint64 bytesReceived, qint64 bytesTotal);
+    void finished(bool success);
+
+private slots:
+    void onProbeFinished();
+    void onThroughputTick();
+    void onVerified(bool success);
+
+private:
+    // 一个连接负责的区间，end可能被窃取而缩短
+    struct Segment
+    {
+        QNetworkReply *reply = nullptr;
+        qint64 start = 0;          // 下一个要写入的偏移
+        qint64 end = 0;            // 独占上界
+        qint64 windowBytes = 0;    // 本统计周期内收到的字节
+        double throughput = 0;     // 字节/秒，指数平滑
+        int retries = 0;
+    };
+
+    void startSingleStream();
+    bool openPartFile(const DownloadJournal *resume);
+    void startSegment(qint64 start, qint64 end, int retries = 0);
+    void onSegmentReadyRead(Segment *segment);
+    void onSegmentFinished(Segment *segment);
+    bool writeSegmentData(Segment *segment);
+    void removeSegment(Segment *segment);
+    void fillIdleConnections();
+    bool stealWork();
+    void saveJournal();
+    void finishDownload();
+    void renameToTarget();
+    void restartFromScratch();
+    void fail(const QString &message);
+
+    static constexpr qint64 kMinSegmentedSize = 32 * 1024 * 1024;  // 小于此大小直接单连接下载
+    static constexpr qint64 kMinStealSize = 4 * 1024 * 1024;       // 剩余不足两倍此值的区间不再拆分
+    static constexpr qint64 kAlignment = 64 * 1024;                // 区间边界对齐
+    static constexpr qint64 kChunkSize = 256 * 1024;
+    static constexpr qint64 kReadBufferSize = 2 * 1024 * 1024;
+    static constexpr qint64 kJournalInterval = 16 * 1024 * 1024;
+    static constexpr int kInitialConnections = 2;
+    static constexpr int kMaxConnections = NetworkLimits::kConnectionsPerHost;
+    static constexpr int kMaxRetries = 3;
+    static constexpr int kTickMs = 1000;
+
+    QNetworkAccessManager *m_manager;
+    QNetworkReply *m_probeReply;
+    DownloadTask *m_singleTask;  // 单连接回退
+    QFile m_file;
+    QByteArray m_chunk;
+    QUrl m_url;
+    QString m_savePath;
+    QString m_errorString;
+    QString m_validator;
+    qint64 m_totalSize;
+    QList<Segment *> m_segments;
+    QList<QPair<qint64, qint64>> m_pendingRanges;  // 尚未分配给连接的区间
+    DownloadVerifier m_verifier;
+
+    // 连接数自适应
+    QTimer m_tickTimer;
+    QElapsedTimer m_windowTimer;
+    int m_targetConnections;
+    int m_maxConnections;
+    double m_lastThroughput;         // 上一周期的总吞吐量
+    double m_throughputBeforeGrowth; // 增加连接前的总吞吐量
+    int m_settleTicks;               // 增加连接后已经过的统计周期数
+    bool m_growthStopped;
+
+    qint64 m_bytesSinceJournal;
+    bool m_restarted;
+    bool m_done;
+};
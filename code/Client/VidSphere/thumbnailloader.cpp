@@ -0,0 +1,677 @@
+//thumbnailloader.cpp
+//AIMD：每个正常响应使上限增加 1/上限，即每完成一个窗口加1；慢响应或出错时上限减半，
+//只对减窗之后发出的请求生效，避免同一批排队请求把上限连续减到最小
+//服务器的缩略图响应带 Cache-Control: no-cache，磁盘缓存中的数据每次都会先向服务器确认
+
+#include "thumbnailloader.h"
+#include "imagescaler.h"
+#include <QBuffer>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkRequest>
+#include <QStandardPaths>
+#include <QThread>
+#include <algorithm>
+#include <limits>
+
+ThumbnailLoader::ThumbnailLoader(QObject *parent)
+    : QObject(parent)
+    , m_manager(new QNetworkAccessManager(this))
+    , m_diskCache(new QNetworkDiskCache(this))
+    , m_memoryCache(kMemoryBudget)
+    , m_encodedCache(kEncodedBudget)
+    , m_running(0)
+    , m_limit(kInitialConcurrency)
+    , m_baselineMs(0)
+    , m_epoch(0)
+    , m_atlasEnabled(false)
+{
+    m_diskCache->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnails");
+    m_diskCache->setMaximumCacheSize(kDiskBudget);
+    m_manager->setCache(m_diskCache);
+
+    // 留一个核心给GUI线程
+    m_decodePool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, kMaxDecodeThreads));
+
+    // 列表重建或滚动时一批视频项在同一轮事件循环中请求并设置优先级，之后统一合批、按优先级发出
+    m_batchTimer.setSingleShot(true);
+    m_batchTimer.setInterval(0);
+    connect(&m_batchTimer, &QTimer::timeout, this, &ThumbnailLoader::flushAtlasBatches);
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+    for (Pending &pending : m_pending) {
+        if (!pending.reply) continue;
+        pending.reply->disconnect(this);
+        pending.reply->abort();
+        pending.reply->deleteLater();
+    }
+    m_decodePool.clear();
+    m_decodePool.waitForDone();
+}
+
+QString ThumbnailLoader::cacheKey(const QUrl &url, const QSize &size)
+{
+    return QString("%1@%2x%3").arg(url.toString()).arg(size.width()).arg(size.height());
+}
+
+// /preview 请求带上显示尺寸，服务器返回能容纳 w*dpr x h*dpr 的最小一档，解码时再缩小到这里换算出的像素尺寸
+QUrl ThumbnailLoader::sizedUrl(const QUrl &url, const QSize &size, qreal dpr)
+{
+    if (!url.path().startsWith("/preview/") || url.hasQuery()) return url;
+    QUrl sized = url;
+    sized.setQuery(QString("w=%1&h=%2&dpr=%3").arg(size.width()).arg(size.height()).arg(dpr));
+    return sized;
+}
+
+void ThumbnailLoader::serve(const Waiter &waiter, QPixmap pixmap)
+{
+    pixmap.setDevicePixelRatio(waiter.dpr);
+    waiter.callback(pixmap);
+}
+
+void ThumbnailLoader::load(const QUrl &imageUrl, const QSize &logicalSize, qreal dpr, QObject *context, Callback callback)
+{
+    dpr = qMax<qreal>(1.0, dpr);
+    QSize size(qRound(logicalSize.width() * dpr), qRound(logicalSize.height() * dpr));
+    QUrl url = sizedUrl(imageUrl, logicalSize, dpr);
+
+    Waiter waiter{context, size, dpr, std::move(callback)};
+    waiter.superseded = std::make_shared<bool>(false);
+
+    // 本次会话中已确认过：滚动回来的视频项只从内存中的像素或压缩数据取，不再请求
+    if (m_validated.contains(url)) {
+        if (QPixmap *cached = m_memoryCache.object(cacheKey(url, size))) {
+            serve(waiter, *cached);
+            return;
+        }
+        if (decodeEncoded(url, waiter)) return;
+    }
+
+    // 缓存命中：立即显示，再向服务器确认是否有变化；磁盘上的文件只有十几KB，读取在GUI线程，解码在后台
+    if (QPixmap *cached = m_memoryCache.object(cacheKey(url, size))) {
+        serve(waiter, *cached);
+        waiter.served = true;
+    } else if (QIODevice *device = m_diskCache->data(url)) {
+        QByteArray data = device->readAll();
+        delete device;
+        waiter.served = true;
+        decodeAsync(data, QRect(), size, [this, url, waiter](const QImage &image) {
+            if (*waiter.superseded) return;
+            QPixmap pixmap = image.isNull() ? QPixmap() : cachePixmap(url, waiter.size, image);
+            if (waiter.context) serve(waiter, pixmap);
+        });
+    }
+
+    auto it = m_pending.find(url);
+    if (it == m_pending.end()) {
+        it = m_pending.insert(url, Pending());
+        if (isAtlasCandidate(url)) {
+            QUrl origin = originOf(url);
+            AtlasBatch &batch = m_atlasBatches[cacheKey(origin, size)];
+            batch.origin = origin;
+            batch.size = size;
+            batch.tileUrls.append(url);
+        } else {
+            m_queue.append(url);
+        }
+    }
+    it->waiters.append(std::move(waiter));
+
+    // 等调用方在本轮事件循环中设置完优先级再发出
+    m_batchTimer.start();
+}
+
+void ThumbnailLoader::setPriority(QObject *context, int priority)
+{
+    for (Pending &pending : m_pending) {
+        for (Waiter &waiter : pending.waiters) {
+            if (waiter.context == context) waiter.priority = priority;
+        }
+    }
+}
+
+void ThumbnailLoader::cancel(QObject *context)
+{
+    QList<QUrl> abandoned;
+    for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+        qsizetype removed = it->waiters.removeIf([context](const Waiter &waiter) { return waiter.context == context; });
+        if (removed > 0 && it->waiters.isEmpty() && !it->reply && it->tileUrls.isEmpty()) abandoned.append(it.key());
+    }
+
+    // 还在队列或拼图批次中的直接丢弃；已编入拼图请求的由pump在发出前检查
+    for (const QUrl &url : std::as_const(abandoned)) {
+        bool dropped = m_queue.removeAll(url) > 0;
+        for (AtlasBatch &batch : m_atlasBatches) { dropped = batch.tileUrls.removeAll(url) > 0 || dropped; }
+        if (dropped) m_pending.remove(url);
+    }
+}
+
+// 拼图请求取其中缩略图的最高优先级
+int ThumbnailLoader::priorityOf(const Pending &pending) const
+{
+    int priority = std::numeric_limits<int>::max();
+    for (const Waiter &waiter : pending.waiters) {
+        if (waiter.context) priority = qMin(priority, waiter.priority);
+    }
+    for (const QUrl &tileUrl : pending.tileUrls) {
+        auto tile = m_pending.constFind(tileUrl);
+        if (tile != m_pending.cend()) priority = qMin(priority, priorityOf(*tile));
+    }
+    return priority;
+}
+
+int ThumbnailLoader::takeNextQueued()
+{
+    int best = 0;
+    int bestPriority = std::numeric_limits<int>::max();
+    for (int i = 0; i < m_queue.size(); ++i) {
+        auto it = m_pending.constFind(m_queue.at(i));
+        if (it == m_pending.cend()) return i;  // 已移除，先清掉
+        int priority = priorityOf(*it);
+        if (priority < bestPriority) {
+            best = i;
+            bestPriority = priority;
+        }
+    }
+    return best;
+}
+
+// 拼图请求看其中的缩略图是否还有人等待
+bool ThumbnailLoader::hasLiveWaiter(const Pending &pending) const
+{
+    for (const Waiter &waiter : pending.waiters) {
+        if (waiter.context) return true;
+    }
+    for (const QUrl &tileUrl : pending.tileUrls) {
+        auto tile = m_pending.constFind(tileUrl);
+        if (tile != m_pending.cend() && hasLiveWaiter(*tile)) return true;
+    }
+    return false;
+}
+
+void ThumbnailLoader::pump()
+{
+    while (m_running < static_cast<int>(m_limit) && !m_queue.isEmpty()) {
+        QUrl url = m_queue.takeAt(takeNextQueued());
+        auto it = m_pending.find(url);
+        if (it == m_pending.end()) continue;
+
+        // 等待的视频项都已销毁（列表刷新），不再请求
+        if (!hasLiveWaiter(*it)) {
+            const QList<QUrl> tileUrls = it->tileUrls;
+            m_pending.erase(it);
+            for (const QUrl &tileUrl : tileUrls) { m_pending.remove(tileUrl); }
+            continue;
+        }
+
+        // Qt的WebP插件（qtimageformats）未安装时只接受JPEG
+        static const QByteArray accept = QImageReader::supportedImageFormats().contains("webp")
+                                             ? QByteArrayLiteral("image/webp,image/jpeg;q=0.9,*/*;q=0.5")
+                                             : QByteArrayLiteral("image/jpeg,*/*;q=0.5");
+
+        QNetworkRequest request(url);
+        request.setRawHeader("Accept", accept);
+        request.setTransferTimeout(kTimeoutMs);
+        it->reply = m_manager->get(request);
+        it->timer.start();
+        it->epoch = m_epoch;
+        m_running++;
+        connect(it->reply, &QNetworkReply::readyRead, this, [this, url]() { onReplyProgress(url); });
+        connect(it->reply, &QNetworkReply::finished, this, [this, url]() { onReplyFinished(url); });
+    }
+}
+
+void ThumbnailLoader::onReplyFinished(const QUrl &url)
+{
+    Pending pending = m_pending.take(url);
+    m_running--;
+
+    QNetworkReply *reply = pending.reply;
+    reply->deleteLater();
+
+    bool ok = reply->error() == QNetworkReply::NoError;
+    // 404等是服务器正常回答，不代表拥塞
+    bool congested = !ok && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 0;
+    onSample(pending.timer.elapsed(), pending.epoch, !congested);
+
+    // 304时QNetworkAccessManager返回磁盘缓存中的数据，此时图片没有变化
+    bool unchanged = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+    if (!pending.tileUrls.isEmpty()) {
+        onAtlasFinished(url, pending, reply, ok, unchanged);
+        pump();
+        return;
+    }
+
+    QByteArray data = ok ? pending.received + reply->readAll() : QByteArray();
+    if (ok) storeEncoded(url, data);
+
+    // 同一尺寸只解码一次
+    QHash<QString, QList<Waiter>> bySize;
+    for (const Waiter &waiter : std::as_const(pending.waiters)) {
+        if (!waiter.context) continue;
+        if (waiter.served && (unchanged || !ok)) continue;
+        if (!ok) {
+            serve(waiter, QPixmap());
+            continue;
+        }
+        *waiter.superseded = true;
+        bySize[cacheKey(url, waiter.size)].append(waiter);
+    }
+
+    for (const QList<Waiter> &waiters : std::as_const(bySize)) {
+        QSize size = waiters.first().size;
+        decodeAsync(data, QRect(), size, [this, url, size, waiters](const QImage &image) {
+            QPixmap pixmap = image.isNull() ? QPixmap() : cachePixmap(url, size, image);
+            for (const Waiter &waiter : waiters) {
+                if (waiter.context) serve(waiter, pixmap);
+            }
+        });
+    }
+    pump();
+}
+
+// 从内存中的压缩数据解码，拼图中的缩略图只解码它所在的区域
+bool ThumbnailLoader::decodeEncoded(const QUrl &url, const Waiter &waiter)
+{
+    auto tile = m_atlasTiles.constFind(url);
+    bool fromAtlas = tile != m_atlasTiles.cend();
+    QByteArray *data = m_encodedCache.object(fromAtlas ? tile->atlasUrl : url);
+    if (!data) return false;
+
+    decodeAsync(*data, fromAtlas ? tile->rect : QRect(), waiter.size, [this, url, waiter](const QImage &image) {
+        QPixmap pixmap = image.isNull() ? QPixmap() : cachePixmap(url, waiter.size, image);
+        if (waiter.context) serve(waiter, pixmap);
+    });
+    return true;
+}
+
+// 服务器确认过的数据（200或304）
+void ThumbnailLoader::storeEncoded(const QUrl &url, const QByteArray &data)
+{
+    m_encodedCache.insert(url, new QByteArray(data), qMax<qsizetype>(1, data.size()));
+    m_atlasTiles.remove(url);
+    m_validated.insert(url);
+}
+
+// 收到新数据：渐进式JPEG多收完一个扫描时，解码已收到的部分给还没有图片的等待者先显示
+void ThumbnailLoader::onReplyProgress(const QUrl &url)
+{
+    auto it = m_pending.find(url);
+    if (it == m_pending.end() || !it->reply) return;
+    it->received += it->reply->readAll();
+    if (it->partialDecoding) return;  // 上一次还没解码完，下个扫描到达时再解码
+
+    int scanEnd = progressiveScanEnd(it->received);
+    if (scanEnd <= it->shownScanEnd) return;
+
+    // 只给没有显示过缓存图片的等待者，最终结果到达后作废
+    auto liveWaiters = [](const Pending &pending) {
+        QList<Waiter> result;
+        for (const Waiter &waiter : pending.waiters) {
+            if (waiter.context && !waiter.served && !*waiter.superseded) result.append(waiter);
+        }
+        return result;
+    };
+    QList<Waiter> waiters = liveWaiters(*it);
+    QHash<QString, QList<Waiter>> tileWaiters;
+    for (const QUrl &tileUrl : std::as_const(it->tileUrls)) {
+        auto tile = m_pending.constFind(tileUrl);
+        if (tile == m_pending.cend()) continue;
+        QList<Waiter> live = liveWaiters(*tile);
+        if (!live.isEmpty()) tileWaiters.insert(tileName(tileUrl), live);
+    }
+    if (waiters.isEmpty() && tileWaiters.isEmpty()) return;
+
+    it->shownScanEnd = scanEnd;
+    it->partialDecoding = true;
+    QByteArray partial = it->received.left(scanEnd) + QByteArrayLiteral("\xFF\xD9");  // 补上EOI，成为扫描较少的完整JPEG
+    auto finished = [this, url]() {
+        auto pending = m_pending.find(url);
+        if (pending != m_pending.end()) pending->partialDecoding = false;
+    };
+
+    if (!it->tileUrls.isEmpty()) {
+        QHash<QString, QRect> rects = parseAtlasIndex(it->reply->rawHeader("X-Atlas-Index"));
+        QSize tileSize = it->tileSize;
+        decodeAtlasAsync(partial, rects, [tileWaiters, tileSize, finished](const QHash<QString, QImage> &images) {
+            finished();
+            for (auto tile = tileWaiters.cbegin(); tile != tileWaiters.cend(); ++tile) {
+                QImage image = images.value(tile.key());
+                if (image.isNull()) continue;
+                for (const Waiter &waiter : tile.value()) {
+                    if (!waiter.context || *waiter.superseded) continue;
+                    QImage scaled = waiter.size == tileSize ? image : ImageScaler::downscale(image, waiter.size, Qt::KeepAspectRatio);
+                    serve(waiter, QPixmap::fromImage(scaled));
+                }
+            }
+        });
+        return;
+    }
+
+    // 不同尺寸的等待者很少见，按第一个的尺寸解码，其余等最终结果
+    QSize size = waiters.first().size;
+    decodeAsync(partial, QRect(), size, [waiters, size, finished](const QImage &image) {
+        finished();
+        if (image.isNull()) return;
+        QPixmap pixmap = QPixmap::fromImage(image);
+        for (const Waiter &waiter : waiters) {
+            if (waiter.context && !*waiter.superseded && waiter.size == size) serve(waiter, pixmap);
+        }
+    });
+}
+
+// 渐进式JPEG中最后一个已收完的扫描的结束位置；不是渐进式JPEG、还没有收完的扫描或整张已收完时返回0
+// 扫描的熵编码数据中0xFF后面只会跟0x00（填充）或RST标记，遇到其他标记说明这个扫描已经结束
+int ThumbnailLoader::progressiveScanEnd(const QByteArray &data)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    const int size = data.size();
+    if (size < 4 || p[0] != 0xFF || p[1] != 0xD8) return 0;
+
+    bool progressive = false;
+    int lastEnd = 0;
+    int pos = 2;
+    while (pos + 4 <= size) {
+        if (p[pos] != 0xFF) return lastEnd;
+        uchar marker = p[pos + 1];
+        if (marker == 0xFF) {  // 标记前的填充字节
+            ++pos;
+            continue;
+        }
+        if (marker == 0xD9) return 0;  // EOI，整张已收完，等finished时解码最终结果
+        if (marker == 0xC2) progressive = true;  // SOF2
+        pos += 2 + ((p[pos + 2] << 8) | p[pos + 3]);
+        if (marker != 0xDA) continue;  // 不是SOS，跳过整个段
+        if (!progressive) return 0;
+
+        while (pos + 1 < size && !(p[pos] == 0xFF && p[pos + 1] != 0x00 && (p[pos + 1] < 0xD0 || p[pos + 1] > 0xD7))) {
+            ++pos;
+        }
+        if (pos + 1 >= size) return lastEnd;  // 这个扫描还没收完
+        lastEnd = pos;
+    }
+    return lastEnd;
+}
+
+void ThumbnailLoader::decodeAsync(const QByteArray &data, const QRect &clip, const QSize &size,
+                                  std::function<void(const QImage &)> done)
+{
+    m_decodePool.start([this, data, clip, size, done]() {
+        QImage image = decode(data, clip, size);
+        QMetaObject::invokeMethod(this, [image, done]() { done(image); }, Qt::QueuedConnection);
+    });
+}
+
+// JPEG解码器在DCT阶段按1/2、1/4、1/8缩小，这里只取不小于目标尺寸的那一级，剩余部分用面积平均缩小
+QImage ThumbnailLoader::decode(const QByteArray &data, const QRect &clip, const QSize &size)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    QSize sourceSize = reader.size();
+    if (clip.isValid()) {
+        reader.setClipRect(clip);  // 拼图中的一格已是目标尺寸，不需要DCT缩小
+    } else if (sourceSize.isValid() && reader.format() == "jpeg") {
+        QSize target = sourceSize.scaled(size, Qt::KeepAspectRatio);
+        QSize reduced = sourceSize;
+        for (int i = 0; i < 3; ++i) {
+            QSize half((reduced.width() + 1) / 2, (reduced.height() + 1) / 2);  // 与libjpeg的取整相同，不会再二次缩放
+            if (half.width() < target.width() || half.height() < target.height()) break;
+            reduced = half;
+        }
+        if (reduced != sourceSize) reader.setScaledSize(reduced);
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) return QImage();
+    image = ImageScaler::downscale(image, size, Qt::KeepAspectRatio);
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+// GUI线程：转换为QPixmap并放入内存缓存
+QPixmap ThumbnailLoader::cachePixmap(const QUrl &url, const QSize &size, const QImage &image)
+{
+    QPixmap pixmap = QPixmap::fromImage(image);
+    qint64 cost = static_cast<qint64>(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+    m_memoryCache.insert(cacheKey(url, size), new QPixmap(pixmap), cost);
+    return pixmap;
+}
+
+QUrl ThumbnailLoader::originOf(const QUrl &url)
+{
+    return url.adjusted(QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment);
+}
+
+QString ThumbnailLoader::tileName(const QUrl &url)
+{
+    return url.path(QUrl::FullyDecoded).mid(QString("/preview/").size());
+}
+
+bool ThumbnailLoader::isAtlasCandidate(const QUrl &url) const
+{
+    return m_atlasEnabled && url.path().startsWith("/preview/") && !tileName(url).isEmpty()
+           && !tileName(url).contains('/') && !m_atlasUnsupported.contains(originOf(url).toString());
+}
+
+// 把本轮事件循环中请求的缩略图按每组kAtlasTiles个发出拼图请求
+void ThumbnailLoader::flushAtlasBatches()
+{
+    for (const AtlasBatch &batch : std::as_const(m_atlasBatches)) {
+        // 视口内的先拼进第一张拼图，每个缩略图的优先级只计算一次
+        QList<QPair<int, QUrl>> prioritized;
+        prioritized.reserve(batch.tileUrls.size());
+        for (const QUrl &tileUrl : batch.tileUrls) {
+            auto pending = m_pending.constFind(tileUrl);
+            int priority = pending != m_pending.cend() ? priorityOf(*pending) : std::numeric_limits<int>::max();
+            prioritized.append(qMakePair(priority, tileUrl));
+        }
+        std::stable_sort(prioritized.begin(), prioritized.end(),
+                         [](const QPair<int, QUrl> &a, const QPair<int, QUrl> &b) { return a.first < b.first; });
+        QList<QUrl> orderedUrls;
+        orderedUrls.reserve(prioritized.size());
+        for (const auto &entry : std::as_const(prioritized)) { orderedUrls.append(entry.second); }
+
+        for (int start = 0; start < orderedUrls.size(); start += kAtlasTiles) {
+            QList<QUrl> tileUrls = orderedUrls.mid(start, kAtlasTiles);
+            if (tileUrls.size() == 1) {
+                m_queue.append(tileUrls.first());
+                continue;
+            }
+
+            // 文件名中可能有 + & =，全部百分号编码
+            QStringList queryItems;
+            for (const QUrl &tileUrl : std::as_const(tileUrls)) {
+                queryItems.append("f=" + QString::fromLatin1(QUrl::toPercentEncoding(tileName(tileUrl))));
+            }
+            queryItems.append(QString("w=%1").arg(batch.size.width()));
+            queryItems.append(QString("h=%1").arg(batch.size.height()));
+
+            QUrl atlasUrl = batch.origin;
+            atlasUrl.setPath("/previews");
+            atlasUrl.setQuery(queryItems.join('&'), QUrl::StrictMode);
+
+            Pending &atlas = m_pending[atlasUrl];
+            atlas.tileUrls = tileUrls;
+            atlas.tileSize = batch.size;
+            m_queue.append(atlasUrl);
+            loadCachedAtlas(atlasUrl);
+        }
+    }
+    m_atlasBatches.clear();
+    pump();
+}
+
+// 磁盘缓存中有同一页的拼图时先切开显示，请求仍然发出确认是否有变化
+void ThumbnailLoader::loadCachedAtlas(const QUrl &atlasUrl)
+{
+    QIODevice *device = m_diskCache->data(atlasUrl);
+    if (!device) return;
+    QByteArray data = device->readAll();
+    delete device;
+
+    QHash<QString, QRect> rects;
+    const QList<QNetworkCacheMetaData::RawHeader> headers = m_diskCache->metaData(atlasUrl).rawHeaders();
+    for (const QNetworkCacheMetaData::RawHeader &header : headers) {
+        if (header.first.compare("X-Atlas-Index", Qt::CaseInsensitive) == 0) rects = parseAtlasIndex(header.second);
+    }
+
+    const Pending atlas = m_pending.value(atlasUrl);
+    QList<QPair<QUrl, Waiter>> targets;
+    for (const QUrl &tileUrl : atlas.tileUrls) {
+        if (!rects.contains(tileName(tileUrl))) continue;
+        for (Waiter &waiter : m_pending[tileUrl].waiters) {
+            if (waiter.served || !waiter.context) continue;
+            waiter.served = true;
+            targets.append({tileUrl, waiter});
+        }
+    }
+    if (targets.isEmpty()) return;
+
+    decodeAtlasAsync(data, rects, [this, targets, tileSize = atlas.tileSize](const QHash<QString, QImage> &images) {
+        for (const auto &target : targets) {
+            const Waiter &waiter = target.second;
+            QImage image = images.value(tileName(target.first));
+            if (*waiter.superseded || !waiter.context || image.isNull()) continue;
+            if (waiter.size != tileSize) image = ImageScaler::downscale(image, waiter.size, Qt::KeepAspectRatio);
+            serve(waiter, cachePixmap(target.first, waiter.size, image));
+        }
+    });
+}
+
+void ThumbnailLoader::onAtlasFinished(const QUrl &atlasUrl, const Pending &atlas, QNetworkReply *reply, bool ok, bool unchanged)
+{
+    // 旧版服务器没有拼图接口，之后对它逐个请求
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status == 404 || status == 405) {
+        m_atlasUnsupported.insert(originOf(atlasUrl).toString());
+        for (const QUrl &tileUrl : atlas.tileUrls) { requeue(tileUrl); }
+        return;
+    }
+    if (!ok) {
+        for (const QUrl &tileUrl : atlas.tileUrls) { deliverTile(tileUrl, atlas.tileSize, QImage(), false); }
+        return;
+    }
+
+    // 压缩的拼图留在内存中，其中的缩略图再次进入视口时按位置单独解码
+    QByteArray data = atlas.received + reply->readAll();
+    QHash<QString, QRect> rects = parseAtlasIndex(reply->rawHeader("X-Atlas-Index"));
+    m_encodedCache.insert(atlasUrl, new QByteArray(data), qMax<qsizetype>(1, data.size()));
+
+    // 服务器上还没有缩略图的文件不在拼图中，单独请求 /preview，由服务器现场生成
+    QList<QUrl> included;
+    bool needDecode = false;
+    for (const QUrl &tileUrl : atlas.tileUrls) {
+        auto tile = m_pending.find(tileUrl);
+        if (tile == m_pending.end()) continue;
+        if (!rects.contains(tileName(tileUrl))) {
+            requeue(tileUrl);
+            continue;
+        }
+        included.append(tileUrl);
+        m_atlasTiles.insert(tileUrl, AtlasTile{atlasUrl, rects.value(tileName(tileUrl))});
+        m_validated.insert(tileUrl);
+        for (Waiter &waiter : tile->waiters) {
+            if (!unchanged) *waiter.superseded = true;
+            if (!waiter.served || !unchanged) needDecode = true;
+        }
+    }
+
+    // 304且所有视频项都已从缓存显示，不必再解码
+    if (!needDecode) {
+        for (const QUrl &tileUrl : std::as_const(included)) { m_pending.remove(tileUrl); }
+        return;
+    }
+
+    decodeAtlasAsync(data, rects,
+                     [this, included, tileSize = atlas.tileSize, unchanged](const QHash<QString, QImage> &images) {
+                         for (const QUrl &tileUrl : included) {
+                             deliverTile(tileUrl, tileSize, images.value(tileName(tileUrl)), unchanged);
+                         }
+                     });
+}
+
+// 把拼图中切出的一张缩略图交给等待者
+void ThumbnailLoader::deliverTile(const QUrl &url, const QSize &tileSize, const QImage &image, bool unchanged)
+{
+    Pending pending = m_pending.take(url);
+    for (const Waiter &waiter : std::as_const(pending.waiters)) {
+        if (!waiter.context) continue;
+        if (waiter.served && (unchanged || image.isNull())) continue;
+        if (image.isNull()) {
+            serve(waiter, QPixmap());
+            continue;
+        }
+        QImage scaled = waiter.size == tileSize ? image : ImageScaler::downscale(image, waiter.size, Qt::KeepAspectRatio);
+        serve(waiter, cachePixmap(url, waiter.size, scaled));
+    }
+}
+
+// 拼图中没有的缩略图改为单独请求
+void ThumbnailLoader::requeue(const QUrl &url)
+{
+    if (m_pending.contains(url)) m_queue.append(url);
+}
+
+void ThumbnailLoader::decodeAtlasAsync(const QByteArray &data, const QHash<QString, QRect> &rects,
+                                       std::function<void(const QHash<QString, QImage> &)> done)
+{
+    m_decodePool.start([this, data, rects, done]() {
+        QHash<QString, QImage> images = decodeAtlas(data, rects);
+        QMetaObject::invokeMethod(this, [images, done]() { done(images); }, Qt::QueuedConnection);
+    });
+}
+
+// 整张拼图只解码一次，按位置切开
+QHash<QString, QImage> ThumbnailLoader::decodeAtlas(const QByteArray &data, const QHash<QString, QRect> &rects)
+{
+    QHash<QString, QImage> images;
+    QImage atlas;
+    if (!atlas.loadFromData(data)) return images;
+    atlas = atlas.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    for (auto it = rects.cbegin(); it != rects.cend(); ++it) {
+        if (!atlas.rect().contains(it.value())) continue;
+        images.insert(it.key(), atlas.copy(it.value()));
+    }
+    return images;
+}
+
+// X-Atlas-Index: {"tile_width":..,"tile_height":..,"tiles":{"文件名":[x,y,宽,高],...}}
+QHash<QString, QRect> ThumbnailLoader::parseAtlasIndex(const QByteArray &index)
+{
+    QHash<QString, QRect> rects;
+    const QJsonObject tiles = QJsonDocument::fromJson(index).object()["tiles"].toObject();
+    for (auto it = tiles.constBegin(); it != tiles.constEnd(); ++it) {
+        QJsonArray rect = it.value().toArray();
+        if (rect.size() != 4) continue;
+        QRect tileRect(rect[0].toInt(), rect[1].toInt(), rect[2].toInt(), rect[3].toInt());
+        if (tileRect.isValid()) rects.insert(it.key(), tileRect);
+    }
+    return rects;
+}
+
+// 根据一次响应调整并发上限
+void ThumbnailLoader::onSample(qint64 ms, int epoch, bool ok)
+{
+    if (ok) {
+        if (m_baselineMs <= 0 || ms < m_baselineMs) {
+            m_baselineMs = ms;
+        } else {
+            m_baselineMs += (ms - m_baselineMs) * 0.01;  // 服务器长期变慢时基线跟着上浮
+        }
+    }
+
+    bool slow = !ok || ms > qMax(kSlowFactor * m_baselineMs, m_baselineMs + 50.0);
+    if (!slow) {
+        m_limit = qMin<double>(kMaxConcurrency, m_limit + 1.0 / m_limit);
+    } else if (epoch == m_epoch) {
+        m_limit = qMax<double>(kMinConcurrency, m_limit / 2);
+        m_epoch++;
+    }
+}
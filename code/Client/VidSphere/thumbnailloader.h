@@ -0,0 +1,173 @@
+//thumbnailloader.h
+//缩略图加载服务：所有视频项共用一个QNetworkAccessManager，同一URL同时只有一个请求，结果分发给所有等待者
+//同时进行的请求数按AIMD调整：响应时间接近基线时每满一个窗口加1，明显变慢或出错时减半，
+//视频很多时不会一次向服务器打开几百个连接
+//三级缓存：内存中按解码后字节数限额的小LRU，只容纳视口附近的缩略图；内存中另存所有缩略图的压缩数据（JPEG/WebP），
+//本次会话已向服务器确认过的缩略图重新进入视口时直接从压缩数据解码，不再请求；磁盘上的QNetworkDiskCache按URL
+//保存原始数据和ETag/Last-Modified，重新请求时带If-None-Match/If-Modified-Since，未变化时服务器只回304
+//内存占用随视口大小而不是视频数量增长：视频项离开视口后丢弃像素，像素缓存很快被淘汰，只有压缩数据常驻
+//解码在后台线程池中进行：JPEG先在DCT阶段按2的幂缩小，剩余部分由ImageScaler面积平均缩小，
+//GUI线程只把现成的QImage转换为QPixmap
+//拼图模式：同一轮事件循环中请求的 <服务器>/preview/<文件名> 每kAtlasTiles个合并为一个 GET /previews，
+//服务器拼成一张JPEG并在X-Atlas-Index头中给出各缩略图的位置，客户端解码一次后切开；服务器不支持时退回逐个请求
+//渐进显示：渐进式JPEG每收完一个扫描就把已收到的部分补上EOI解码一次，先显示粗略的整张图，之后逐步清晰；
+//拼图同样处理。WebP和基线JPEG只在收完后显示
+//优先级：调用方按与视口的距离给每个等待者设置优先级，排队的请求每次取优先级最高的发出，拼图也先拼优先级高的；
+//视频项离开预取范围时取消，尚未发出的请求直接丢弃
+//按尺寸请求：<服务器>/preview/<文件名> 带上 w、h、dpr，服务器返回与实际绘制像素数相同的版本，能解码WebP时优先请求WebP
+
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QCache>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
+#include <QNetworkReply>
+#include <QPixmap>
+#include <QPointer>
+#include <QRect>
+#include <QSet>
+#include <QSize>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <functional>
+#include <memory>
+#include "networklimits.h"
+
+class ThumbnailLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(const QPixmap &pixmap)>;  // 失败时pixmap为空
+
+    explicit ThumbnailLoader(QObject *parent = nullptr);
+    ~ThumbnailLoader();
+
+    // 请求一张缩放到size以内（保持比例）的缩略图，context仍存在时调用callback，销毁后自动放弃
+    // size为逻辑像素，按dpr换算成实际像素请求和解码，回调的QPixmap带有对应的devicePixelRatio
+    // 内存或磁盘缓存中有时立即回调，之后仍向服务器确认一次，图片有变化时再回调一次
+    void load(const QUrl &url, const QSize &size, qreal dpr, QObject *context, Callback callback);
+
+    void setAtlasEnabled(bool enabled) { m_atlasEnabled = enabled; }
+
+    // 视频列表刷新时调用，之后的请求都重新向服务器确认一次
+    void revalidate() { m_validated.clear(); }
+
+    // 数值越小越先请求，通常是与视口的像素距离；load之后在同一轮事件循环中设置即可生效
+    void setPriority(QObject *context, int priority);
+    // 不再为context回调；只有它在等的请求如果还没发出就丢弃，已发出的照常完成并写入缓存
+    void cancel(QObject *context);
+
+    int getConcurrency() const { return static_cast<int>(m_limit); }
+    int getRunningCount() const { return m_running; }
+
+private:
+    // 等待某个URL的一方
+    struct Waiter
+    {
+        QPointer<QObject> context;
+        QSize size;  // 实际像素
+        qreal dpr = 1.0;
+        Callback callback;
+        int priority = 0;
+        bool served = false;  // 已用缓存回调过（或磁盘缓存正在解码），图片未变化时不再回调
+        std::shared_ptr<bool> superseded;  // 服务器返回了新图片，稍后完成的磁盘缓存解码作废
+    };
+
+    // 同一URL的所有等待者共享一个请求
+    struct Pending
+    {
+        QList<Waiter> waiters;
+        QNetworkReply *reply = nullptr;
+        QElapsedTimer timer;
+        int epoch = 0;  // 发出时的减窗次数，同一窗口内的多个慢响应只减一次
+        QList<QUrl> tileUrls;  // 拼图请求包含的缩略图，普通请求为空
+        QSize tileSize;
+        QByteArray received;   // 已收到的数据
+        int shownScanEnd = 0;  // 已显示到的扫描结束位置
+        bool partialDecoding = false;
+    };
+
+    // 拼图中的一张缩略图，压缩数据按拼图URL保存
+    struct AtlasTile
+    {
+        QUrl atlasUrl;
+        QRect rect;
+    };
+
+    // 同一服务器、同一尺寸、尚未发出的缩略图
+    struct AtlasBatch
+    {
+        QUrl origin;
+        QSize size;
+        QList<QUrl> tileUrls;
+    };
+
+    void pump();                  // 按当前并发上限发出排队的请求
+    static void serve(const Waiter &waiter, QPixmap pixmap);
+    static QUrl sizedUrl(const QUrl &url, const QSize &size, qreal dpr);
+    void onReplyFinished(const QUrl &url);
+    void onReplyProgress(const QUrl &url);
+    static int progressiveScanEnd(const QByteArray &data);
+    void onSample(qint64 ms, int epoch, bool ok);
+    bool hasLiveWaiter(const Pending &pending) const;
+    int priorityOf(const Pending &pending) const;
+    int takeNextQueued();         // 队列中优先级最高的位置，并列时取先加入的
+    bool decodeEncoded(const QUrl &url, const Waiter &waiter);
+    void storeEncoded(const QUrl &url, const QByteArray &data);
+    void decodeAsync(const QByteArray &data, const QRect &clip, const QSize &size, std::function<void(const QImage &)> done);
+    static QImage decode(const QByteArray &data, const QRect &clip, const QSize &size);  // 在工作线程中执行，clip为空时解码整张
+    QPixmap cachePixmap(const QUrl &url, const QSize &size, const QImage &image);
+    static QString cacheKey(const QUrl &url, const QSize &size);
+
+    bool isAtlasCandidate(const QUrl &url) const;
+    void flushAtlasBatches();
+    void loadCachedAtlas(const QUrl &atlasUrl);
+    void onAtlasFinished(const QUrl &atlasUrl, const Pending &atlas, QNetworkReply *reply, bool ok, bool unchanged);
+    void decodeAtlasAsync(const QByteArray &data, const QHash<QString, QRect> &rects,
+                          std::function<void(const QHash<QString, QImage> &)> done);
+    static QHash<QString, QImage> decodeAtlas(const QByteArray &data, const QHash<QString, QRect> &rects);  // 在工作线程中执行
+    static QHash<QString, QRect> parseAtlasIndex(const QByteArray &index);
+    void deliverTile(const QUrl &url, const QSize &tileSize, const QImage &image, bool unchanged);
+    void requeue(const QUrl &url);
+    static QUrl originOf(const QUrl &url);
+    static QString tileName(const QUrl &url);
+
+    static constexpr int kMinConcurrency = 1;
+    static constexpr int kMaxConcurrency = NetworkLimits::kConnectionsPerHost;
+    static constexpr double kInitialConcurrency = 2;
+    static constexpr double kSlowFactor = 2.0;    // 响应时间超过基线的倍数视为拥塞
+    static constexpr int kTimeoutMs = 15000;
+    static constexpr int kMaxDecodeThreads = 4;
+    static constexpr int kAtlasTiles = 48;        // 每个拼图的缩略图数，约为一屏
+    static constexpr qint64 kMemoryBudget = 16LL * 1024 * 1024;  // 解码后的像素数据，约几屏
+    static constexpr qint64 kEncodedBudget = 64LL * 1024 * 1024; // 压缩数据，一张十几KB，上万个视频也放得下
+    static constexpr qint64 kDiskBudget = 256LL * 1024 * 1024;
+
+    QThreadPool m_decodePool;
+    QNetworkAccessManager *m_manager;
+    QNetworkDiskCache *m_diskCache;
+    QCache<QString, QPixmap> m_memoryCache;  // 键为URL和尺寸，开销为像素字节数
+    QCache<QUrl, QByteArray> m_encodedCache; // 键为缩略图或拼图的URL，开销为字节数
+    QHash<QUrl, AtlasTile> m_atlasTiles;     // 来自拼图的缩略图在拼图中的位置
+    QSet<QUrl> m_validated;                  // 本次会话已向服务器确认过的缩略图
+    QHash<QUrl, Pending> m_pending;          // 排队中和进行中的请求
+    QList<QUrl> m_queue;                     // 尚未发出的URL，按请求顺序
+    int m_running;
+    double m_limit;                          // 并发上限，加法增长时带小数
+    double m_baselineMs;                     // 无拥塞时的响应时间，取近期最小值并缓慢上浮
+    int m_epoch;
+
+    // 拼图模式
+    bool m_atlasEnabled;
+    QHash<QString, AtlasBatch> m_atlasBatches;  // 键为服务器和尺寸
+    QSet<QString> m_atlasUnsupported;           // 不支持拼图接口的服务器
+    QTimer m_batchTimer;
+};
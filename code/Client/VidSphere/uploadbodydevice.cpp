@@ -0,0 +1,174 @@
+//uploadbodydevice.cpp
+//后台线程始终读在读取位置之前，窗口满时等待；readData只在窗口里还没有数据时阻塞调用线程（GUI线程）等待，即磁盘比网络慢的时候
+
+#include "uploadbodydevice.h"
+#include <cstring>
+
+UploadBodyDevice::UploadBodyDevice(const QString &filePath, const FaststartLayout &layout, QObject *parent)
+    : QIODevice(parent)
+    , m_file(filePath)
+    , m_layout(layout)
+    , m_map(nullptr)
+    , m_size(0)
+    , m_blocksStart(0)
+    , m_fetchedEnd(0)
+    , m_readPos(0)
+    , m_generation(0)
+    , m_cancelled(false)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+UploadBodyDevice::~UploadBodyDevice()
+{
+    if (isOpen()) close();
+}
+
+bool UploadBodyDevice::open(OpenMode mode)
+{
+    if (mode & WriteOnly) return false;
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+    m_size = m_layout.size;
+    qint64 fileSize = m_file.size();
+    m_map = fileSize > 0 ? m_file.map(0, fileSize) : nullptr;  // 映射失败时退回后台线程读文件
+
+    m_blocks.clear();
+    m_blocksStart = m_fetchedEnd = m_readPos = 0;
+    m_fetchError.clear();
+    m_cancelled = false;
+
+    // 不使用QIODevice自己的缓冲区，数据已经在预读窗口里
+    QIODevice::open(mode | Unbuffered);
+    m_pool.start([this]() { prefetchLoop(); });
+    return true;
+}
+
+void UploadBodyDevice::close()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cancelled = true;
+        m_spaceAvailable.wakeAll();
+    }
+    m_pool.waitForDone();
+
+    m_blocks.clear();  // 映射模式下块指向映射区，必须先于unmap释放
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_file.close();
+    QIODevice::close();
+}
+
+bool UploadBodyDevice::seek(qint64 pos)
+{
+    if (pos < 0 || pos > m_size || !QIODevice::seek(pos)) return false;
+
+    // 窗口内的位置保留已读数据（例如重发时回到开头），否则从新位置重新预读
+    QMutexLocker locker(&m_mutex);
+    if (pos >= m_blocksStart && pos <= m_fetchedEnd) {
+        while (!m_blocks.isEmpty() && m_blocksStart + m_blocks.first().size() <= pos) {
+            m_blocksStart += m_blocks.first().size();
+            m_blocks.removeFirst();
+        }
+    } else {
+        m_blocks.clear();
+        m_blocksStart = m_fetchedEnd = pos;
+        m_generation++;
+    }
+    m_readPos = pos;
+    m_spaceAvailable.wakeAll();
+    return true;
+}
+
+qint64 UploadBodyDevice::readData(char *data, qint64 maxSize)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_readPos >= m_fetchedEnd && m_readPos < m_size && m_fetchError.isEmpty()) {
+        m_dataReady.wait(&m_mutex);
+    }
+    if (m_readPos >= m_fetchedEnd) {
+        if (m_readPos >= m_size) return 0;
+        setErrorString(m_fetchError);
+        return -1;
+    }
+
+    qint64 copied = 0;
+    while (copied < maxSize && !m_blocks.isEmpty()) {
+        const QByteArray &block = m_blocks.first();
+        qint64 inBlock = m_readPos - m_blocksStart;
+        qint64 n = qMin(maxSize - copied, block.size() - inBlock);
+        std::memcpy(data + copied, block.constData() + inBlock, n);
+        copied += n;
+        m_readPos += n;
+        if (m_readPos - m_blocksStart == block.size()) {
+            m_blocksStart += block.size();
+            m_blocks.removeFirst();
+        }
+    }
+    m_spaceAvailable.wakeAll();
+    return copied;
+}
+
+qint64 UploadBodyDevice::writeData(const char *, qint64)
+{
+    return -1;
+}
+
+void UploadBodyDevice::prefetchLoop()
+{
+    QFile file(m_file.fileName());  // 未映射时后台线程使用自己的文件句柄
+    if (!m_map && !file.open(QIODevice::ReadOnly)) {
+        QMutexLocker locker(&m_mutex);
+        m_fetchError = file.errorString();
+        m_dataReady.wakeAll();
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    while (!m_cancelled) {
+        if (m_fetchedEnd >= m_size || m_fetchedEnd - m_readPos >= kWindowBlocks * kBlockSize) {
+            m_spaceAvailable.wait(&m_mutex);
+            continue;
+        }
+
+        qint64 offset = m_fetchedEnd;
+        qint64 length = qMin(kBlockSize, m_size - offset);
+        int generation = m_generation;
+        locker.unlock();
+        QByteArray block = fetchBlock(file, offset, length);
+        locker.relock();
+
+        if (generation != m_generation) continue;
+        if (block.size() != length) {
+            m_fetchError = file.error() != QFileDevice::NoError ? file.errorString() : QString("文件在上传过程中被截断");
+            m_dataReady.wakeAll();
+            return;
+        }
+        m_blocks.append(block);
+        m_fetchedEnd += length;
+        m_dataReady.wakeAll();
+    }
+}
+
+QByteArray UploadBodyDevice::fetchBlock(QFile &file, qint64 offset, qint64 length)
+{
+    qint64 source = m_map ? m_layout.sourceOffset(offset, length) : -1;
+    if (source >= 0) {
+        // 每页访问一次，缺页和磁盘读取发生在后台线程；块直接引用映射区，不复制
+        const uchar *p = m_map + source;
+        uchar touched = 0;
+        for (qint64 i = 0; i < length; i += 4096) { touched ^= *static_cast<const volatile uchar *>(p + i); }
+        Q_UNUSED(touched);
+        return QByteArray::fromRawData(reinterpret_cast<const char *>(p), length);
+    }
+
+    // 跨过改写后的moov的块，或者无法映射时
+    QByteArray block(length, Qt::Uninitialized);
+    if (!m_layout.read(file, m_map, offset, block.data(), length)) return QByteArray();
+    return block;
+}
@@ -0,0 +1,63 @@
+//uploadbodydevice.h
+//上传请求体：QNetworkAccessManager在GUI线程里从请求体设备读取数据，直接用QFile时每次读取都可能卡在磁盘上
+//这里由后台线程提前读好一个窗口的数据，GUI线程的readData通常只做一次内存复制；
+//磁盘比网络慢、窗口读空时readData仍会在GUI线程上等待下一块（QHttpMultiPart不转发readyRead，不能返回0让网络层稍后再读）
+//能内存映射时窗口中的块直接指向映射区，后台线程只负责触发缺页，不再额外复制
+//读取的是上传数据流，MP4改写后的moov所在的块从内存复制
+
+#pragma once
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <atomic>
+#include "mp4faststart.h"
+
+class UploadBodyDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit UploadBodyDevice(const QString &filePath, const FaststartLayout &layout, QObject *parent = nullptr);
+    ~UploadBodyDevice();
+
+    bool open(OpenMode mode) override;  // 只支持只读
+    void close() override;
+    bool isSequential() const override { return false; }
+    qint64 size() const override { return m_size; }
+    bool seek(qint64 pos) override;
+    bool isMapped() const { return m_map != nullptr; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    void prefetchLoop();
+    QByteArray fetchBlock(QFile &file, qint64 offset, qint64 length);
+
+    static constexpr qint64 kBlockSize = 1024 * 1024;
+    static constexpr int kWindowBlocks = 16;  // 预读窗口，内存上限16 MiB
+
+    QThreadPool m_pool;
+    QFile m_file;
+    FaststartLayout m_layout;
+    uchar *m_map;
+    qint64 m_size;
+
+    // 以下由m_mutex保护
+    QMutex m_mutex;
+    QWaitCondition m_dataReady;
+    QWaitCondition m_spaceAvailable;
+    QList<QByteArray> m_blocks;  // 从m_blocksStart开始连续的已读数据
+    qint64 m_blocksStart;
+    qint64 m_fetchedEnd;         // 后台线程下一次从这里读
+    qint64 m_readPos;
+    int m_generation;            // seek到窗口之外时递增，丢弃正在读的旧块
+    QString m_fetchError;
+    std::atomic<bool> m_cancelled;
+};
@@ -0,0 +1,81 @@
+//uploadjournal.cpp
+
+#include "uploadjournal.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+// 从JSON文件读取日志，文件不存在或格式错误时返回false
+bool UploadJournal::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(file.readAll());
+    if (!jsonDoc.isObject()) return false;
+
+    QJsonObject jsonObj = jsonDoc.object();
+    filePath = jsonObj["file_path"].toString();
+    fileSize = jsonObj["file_size"].toInteger(-1);
+    lastModified = jsonObj["last_modified"].toInteger(0);
+    server = jsonObj["server"].toString();
+    uploadId = jsonObj["upload_id"].toString();
+    chunkSize = jsonObj["chunk_size"].toInteger(0);
+    remuxed = jsonObj["remuxed"].toBool(false);
+
+    ackedChunks.clear();
+    const QJsonArray chunks = jsonObj["acked"].toArray();
+    for (const QJsonValue &value : chunks) { ackedChunks.append(value.toInt()); }
+
+    return !uploadId.isEmpty() && chunkSize > 0;
+}
+
+// 写入日志，QSaveFile保证崩溃时不会留下半个JSON
+bool UploadJournal::save(const QString &path) const
+{
+    QJsonArray chunks;
+    for (int index : ackedChunks) { chunks.append(index); }
+
+    QJsonObject jsonObj;
+    jsonObj["file_path"] = filePath;
+    jsonObj["file_size"] = fileSize;
+    jsonObj["last_modified"] = lastModified;
+    jsonObj["server"] = server;
+    jsonObj["upload_id"] = uploadId;
+    jsonObj["chunk_size"] = chunkSize;
+    jsonObj["remuxed"] = remuxed;
+    jsonObj["acked"] = chunks;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(jsonObj).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+bool UploadJournal::remove(const QString &path)
+{
+    return QFile::remove(path);
+}
+
+bool UploadJournal::matches(const QString &file, const QString &serverAddress) const
+{
+    QFileInfo info(file);
+    return filePath == info.absoluteFilePath()
+           && fileSize == info.size()
+           && lastModified == info.lastModified().toMSecsSinceEpoch()
+           && server == serverAddress;
+}
+
+QString UploadJournal::journalPath(const QString &filePath)
+{
+    QByteArray key = QCryptographicHash::hash(QFileInfo(filePath).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/uploads/" + QString::fromLatin1(key) + ".json";
+}
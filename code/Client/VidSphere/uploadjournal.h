@@ -0,0 +1,29 @@
+//uploadjournal.h
+//分块上传日志：记录本地文件对应的服务器上传会话和已确认的块，客户端崩溃或断线后继续上传
+//日志保存在应用数据目录 uploads/ 下，文件名为本地路径的哈希
+
+#pragma once
+
+#include <QList>
+#include <QString>
+
+struct UploadJournal
+{
+    QString filePath;        // 本地文件
+    qint64 fileSize = -1;
+    qint64 lastModified = 0; // 本地文件修改时间（毫秒），文件变化后会话作废
+    QString server;          // 服务器地址
+    QString uploadId;        // 服务器返回的上传ID
+    qint64 chunkSize = 0;
+    bool remuxed = false;    // 上传的是moov移到前面后的数据流，块号对应的内容与原文件不同
+    QList<int> ackedChunks;  // 服务器已确认的块号
+
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+    static bool remove(const QString &path);
+
+    // 日志是否属于当前的本地文件和服务器
+    bool matches(const QString &file, const QString &serverAddress) const;
+
+    static QString journalPath(const QString &filePath);
+};
@@ -0,0 +1,529 @@
+//uploadmanager.cpp
+//上传队列调度：所有上传先以不允许传输的方式启动，只做本地分析；分析完成后按加入顺序放行到传输名额
+//监视文件夹：目录变化合并2秒后扫描新文件，大小和修改时间连续5秒不变且能打开时才加入队列，避免上传写了一半的文件
+
+#include "uploadmanager.h"
+#include "chunkedupload.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+UploadManager::UploadManager(QNetworkAccessManager *manager, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_nextId(1)
+{
+    m_speedTimer.setInterval(1000);
+    connect(&m_speedTimer, &QTimer::timeout, this, &UploadManager::onSpeedTick);
+
+    // 多次修改合并为一次写盘
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(500);
+    connect(&m_saveTimer, &QTimer::timeout, this, &UploadManager::writeQueueFile);
+
+    // 复制大文件时目录会连续变化多次
+    m_debounceTimer.setSingleShot(true);
+    m_debounceTimer.setInterval(kDebounceMs);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, [this]() { m_debounceTimer.start(); });
+    connect(&m_debounceTimer, &QTimer::timeout, this, &UploadManager::onDirectoryChanged);
+
+    m_checkTimer.setInterval(kCheckIntervalMs);
+    connect(&m_checkTimer, &QTimer::timeout, this, &UploadManager::checkPendingFiles);
+
+    load();
+}
+
+UploadManager::~UploadManager()
+{
+    // 未结束的上传记为排队，下次启动时从服务器已收到的位置继续
+    for (UploadItem &item : m_items) {
+        if (item.isActive()) { item.state = UploadItem::Queued; }
+    }
+    writeQueueFile();
+    qDeleteAll(m_tasks);
+}
+
+void UploadManager::setServerAddress(const QString &serverAddress)
+{
+    m_serverAddress = serverAddress;
+    schedule();
+}
+
+// 加入上传队列
+int UploadManager::enqueue(const QString &filePath)
+{
+    QString absolutePath = QFileInfo(filePath).absoluteFilePath();
+    for (UploadItem &item : m_items) {
+        if (item.filePath == absolutePath && item.state != UploadItem::Completed) {
+            if (item.state == UploadItem::Failed) { retry(item.id); }
+            return item.id;
+        }
+    }
+
+    UploadItem item;
+    item.id = m_nextId++;
+    item.name = QFileInfo(absolutePath).fileName();
+    item.filePath = absolutePath;
+    item.bytesTotal = QFileInfo(absolutePath).size();
+    m_items.append(item);
+
+    emit itemAdded(item.id);
+    save();
+    schedule();
+    return item.id;
+}
+
+int UploadManager::enqueueFiles(const QStringList &filePaths)
+{
+    int added = 0;
+    for (const QString &filePath : filePaths) {
+        int count = m_items.size();
+        enqueue(filePath);
+        if (m_items.size() > count) added++;
+    }
+    return added;
+}
+
+// 重试
+void UploadManager::retry(int id)
+{
+    UploadItem *item = findItem(id);
+    if (!item || item->state != UploadItem::Failed) return;
+
+    item->state = UploadItem::Queued;
+    item->errorString.clear();
+
+    emit itemChanged(id);
+    save();
+    schedule();
+}
+
+// 取消：停止上传并从列表中移除
+void UploadManager::cancel(int id)
+{
+    for (int i = 0; i < m_items.size(); ++i) {
+        if (m_items[i].id != id) continue;
+
+        stopTask(id);
+        m_items.removeAt(i);
+        emit itemRemoved(id);
+        emit statsChanged();
+        save();
+        schedule();
+        return;
+    }
+}
+
+// 清除已完成的上传
+void UploadManager::clearFinished()
+{
+    QList<int> finishedIds;
+    for (const UploadItem &item : m_items) {
+        if (item.state == UploadItem::Completed) { finishedIds.append(item.id); }
+    }
+    for (int id : finishedIds) { cancel(id); }
+}
+
+// 开始监视文件夹，此时已存在的文件不上传
+bool UploadManager::setWatchFolder(const QString &folderPath)
+{
+    if (!m_watchFolder.isEmpty()) { m_watcher.removePath(m_watchFolder); }
+    m_watchFolder.clear();
+    m_knownFiles.clear();
+    m_pendingFiles.clear();
+    m_debounceTimer.stop();
+    m_checkTimer.stop();
+
+    bool ok = true;
+    if (!folderPath.isEmpty()) {
+        QString absolutePath = QFileInfo(folderPath).absoluteFilePath();
+        ok = m_watcher.addPath(absolutePath);
+        if (ok) {
+            m_watchFolder = absolutePath;
+            const QStringList existing = listVideoFiles(absolutePath, false);
+            m_knownFiles = QSet<QString>(existing.cbegin(), existing.cend());
+        }
+    }
+    save();
+    return ok;
+}
+
+const UploadItem *UploadManager::getItem(int id) const
+{
+    for (const UploadItem &item : m_items) {
+        if (item.id == id) return &item;
+    }
+    return nullptr;
+}
+
+UploadItem *UploadManager::findItem(int id)
+{
+    for (UploadItem &item : m_items) {
+        if (item.id == id) return &item;
+    }
+    return nullptr;
+}
+
+int UploadManager::getRunningCount() const
+{
+    int count = 0;
+    for (const UploadItem &item : m_items) {
+        if (item.state == UploadItem::Uploading) count++;
+    }
+    return count;
+}
+
+int UploadManager::getAnalyzingCount() const
+{
+    int count = 0;
+    for (const UploadItem &item : m_items) {
+        if (item.state == UploadItem::Analyzing || item.state == UploadItem::Waiting) count++;
+    }
+    return count;
+}
+
+int UploadManager::getQueuedCount() const
+{
+    int count = 0;
+    for (const UploadItem &item : m_items) {
+        if (item.state == UploadItem::Queued) count++;
+    }
+    return count;
+}
+
+double UploadManager::getTotalSpeed() const
+{
+    double total = 0;
+    for (const UploadItem &item : m_items) {
+        if (item.state == UploadItem::Uploading) total += item.speed;
+    }
+    return total;
+}
+
+qint64 UploadManager::getRemainingBytes() const
+{
+    qint64 remaining = 0;
+    for (const UploadItem &item : m_items) {
+        if (item.isActive()) remaining += qMax<qint64>(0, item.bytesTotal - item.bytesSent);
+    }
+    return remaining;
+}
+
+qint64 UploadManager::getEtaSeconds() const
+{
+    double speed = getTotalSpeed();
+    qint64 remaining = getRemainingBytes();
+    if (remaining == 0) return 0;
+    if (speed <= 0) return -1;
+    return static_cast<qint64>(remaining / speed) + 1;
+}
+
+bool UploadManager::isVideoFile(const QString &filePath)
+{
+    static const QStringList suffixes = {"mp4", "avi", "mov", "mkv", "wmv", "flv", "webm"};
+    return suffixes.contains(QFileInfo(filePath).suffix().toLower());
+}
+
+QStringList UploadManager::listVideoFiles(const QString &folderPath, bool recursive)
+{
+    QStringList filePaths;
+    QDirIterator it(folderPath, QDir::Files | QDir::Readable,
+                    recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        QString filePath = QFileInfo(it.next()).absoluteFilePath();
+        if (isVideoFile(filePath)) filePaths.append(filePath);
+    }
+    filePaths.sort();
+    return filePaths;
+}
+
+// 分析完成的按加入顺序放行，直到传输名额用完；再启动排队项的分析，直到提前量用完
+void UploadManager::schedule()
+{
+    int transferring = getRunningCount();
+    for (UploadItem &item : m_items) {
+        if (transferring >= kMaxTransfers) break;
+        if (item.state != UploadItem::Waiting) continue;
+
+        item.state = UploadItem::Uploading;
+        item.speed = 0;
+        transferring++;
+        emit itemChanged(item.id);
+        m_tasks.value(item.id)->setTransferAllowed(true);
+    }
+
+    // 块并发预算在传输中的上传之间平分，除不尽的部分给先加入的
+    if (transferring > 0) {
+        int perTask = kWindowBudget / transferring;
+        int extra = kWindowBudget % transferring;
+        int index = 0;
+        for (const UploadItem &item : std::as_const(m_items)) {
+            ChunkedUpload *task = m_tasks.value(item.id);
+            if (item.state != UploadItem::Uploading || !task) continue;
+            task->setMaxWindow(perTask + (index++ < extra ? 1 : 0));
+        }
+    }
+
+    // 传输名额有空闲时，分析中的文件完成后可以直接传输
+    if (!m_serverAddress.isEmpty()) {
+        for (UploadItem &item : m_items) {
+            if (m_tasks.size() - getRunningCount() >= kLookahead) break;
+            if (item.state == UploadItem::Queued) startItem(item);
+        }
+    }
+
+    if (m_tasks.isEmpty()) {
+        m_speedTimer.stop();
+    } else if (!m_speedTimer.isActive()) {
+        m_speedTimer.start();
+    }
+    emit statsChanged();
+}
+
+// 启动一个上传的本地分析
+void UploadManager::startItem(UploadItem &item)
+{
+    int id = item.id;
+    item.state = UploadItem::Analyzing;
+    item.speed = 0;
+    item.bytesHashed = 0;
+    item.bytesSent = 0;
+    item.bytesSkipped = 0;
+    item.errorString.clear();
+
+    ChunkedUpload *task = new ChunkedUpload(m_manager, m_serverAddress, item.filePath, this);
+    task->setTransferAllowed(false);
+
+    connect(task, &ChunkedUpload::hashingProgress, this, [this, id](qint64 bytesHashed, qint64) {
+        UploadItem *item = findItem(id);
+        if (!item) return;
+        item->bytesHashed = bytesHashed;
+        emit itemChanged(id);
+    });
+
+    connect(task, &ChunkedUpload::readyForTransfer, this, [this, id]() {
+        UploadItem *item = findItem(id);
+        if (!item || item->state != UploadItem::Analyzing) return;
+        item->state = UploadItem::Waiting;
+        emit itemChanged(id);
+        schedule();
+    });
+
+    connect(task, &ChunkedUpload::progressChanged, this, [this, id](qint64 bytesSent, qint64 bytesTotal) {
+        UploadItem *item = findItem(id);
+        if (!item) return;
+        // 续传和去重跳过的部分不计入速度
+        if (!m_lastBytes.contains(id)) m_lastBytes.insert(id, bytesSent);
+        item->bytesSent = bytesSent;
+        item->bytesTotal = bytesTotal;
+        emit itemChanged(id);
+    });
+
+    connect(task, &ChunkedUpload::finished, this, [this, id, task](bool success) {
+        m_tasks.remove(id);
+        m_lastBytes.remove(id);
+        task->deleteLater();
+
+        UploadItem *item = findItem(id);
+        if (!item) return;
+
+        item->speed = 0;
+        if (success) {
+            item->state = UploadItem::Completed;
+            item->bytesSent = item->bytesTotal;
+            QJsonObject response = task->getResponse();
+            item->serverFilename = response["filename"].toString();
+            item->bytesSkipped = response["deduplicated"].toBool() ? item->bytesTotal : task->getBytesSkipped();
+        } else {
+            item->state = UploadItem::Failed;
+            item->errorString = task->getErrorString();
+        }
+
+        emit itemChanged(id);
+        emit itemFinished(id, success);
+        save();
+        schedule();
+    });
+
+    if (!task->start()) {
+        item.state = UploadItem::Failed;
+        item.errorString = task->getErrorString();
+        delete task;
+        emit itemChanged(id);
+        emit itemFinished(id, false);
+        save();
+        return;
+    }
+
+    m_tasks.insert(id, task);
+    emit itemChanged(id);
+    save();
+}
+
+// 停止正在运行的上传（不改变状态）
+void UploadManager::stopTask(int id)
+{
+    ChunkedUpload *task = m_tasks.take(id);
+    m_lastBytes.remove(id);
+    if (!task) return;
+
+    task->disconnect(this);
+    task->abort();
+    task->deleteLater();
+}
+
+// 每秒根据字节增量计算速度，做一次平滑
+void UploadManager::onSpeedTick()
+{
+    for (auto it = m_lastBytes.begin(); it != m_lastBytes.end(); ++it) {
+        UploadItem *item = findItem(it.key());
+        if (!item) continue;
+
+        qint64 delta = item->bytesSent - it.value();
+        it.value() = item->bytesSent;
+        item->speed = item->speed > 0 ? 0.5 * item->speed + 0.5 * delta : delta;
+        emit itemChanged(it.key());
+    }
+    emit statsChanged();
+    save();
+}
+
+// 目录变化：新出现的视频先记为待定，等写入完成
+void UploadManager::onDirectoryChanged()
+{
+    if (m_watchFolder.isEmpty()) return;
+
+    // 文件夹被删除或改名后QFileSystemWatcher不再监视
+    if (!QFileInfo::exists(m_watchFolder)) {
+        m_watcher.removePath(m_watchFolder);
+        m_pendingFiles.clear();
+        m_checkTimer.stop();
+        return;
+    }
+
+    const QStringList filePaths = listVideoFiles(m_watchFolder, false);
+    for (const QString &filePath : filePaths) {
+        if (m_knownFiles.contains(filePath) || m_pendingFiles.contains(filePath)) continue;
+        m_pendingFiles.insert(filePath, PendingFile());
+    }
+
+    if (!m_pendingFiles.isEmpty()) {
+        checkPendingFiles();
+        m_checkTimer.start();
+    }
+}
+
+// 检查待定文件是否已写入完成
+void UploadManager::checkPendingFiles()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QStringList readyFiles;
+
+    for (auto it = m_pendingFiles.begin(); it != m_pendingFiles.end();) {
+        QFileInfo fileInfo(it.key());
+        if (!fileInfo.exists()) {
+            it = m_pendingFiles.erase(it);
+            continue;
+        }
+
+        qint64 size = fileInfo.size();
+        qint64 lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+        if (size != it->size || lastModified != it->lastModified) {
+            it->size = size;
+            it->lastModified = lastModified;
+            it->stableSince = now;
+        } else if (size > 0 && now - it->stableSince >= kStableMs) {
+            // 写入方独占打开时（Windows上的复制）这里会失败，继续等待
+            QFile file(it.key());
+            if (file.open(QIODevice::ReadOnly)) { readyFiles.append(it.key()); }
+        }
+        ++it;
+    }
+
+    for (const QString &filePath : std::as_const(readyFiles)) {
+        m_pendingFiles.remove(filePath);
+        m_knownFiles.insert(filePath);
+    }
+    readyFiles.sort();
+    enqueueFiles(readyFiles);
+
+    if (m_pendingFiles.isEmpty()) m_checkTimer.stop();
+}
+
+QString UploadManager::queueFilePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/uploads.json";
+}
+
+// 读取上次保存的队列，未结束的上传恢复为排队
+void UploadManager::load()
+{
+    QFile file(queueFilePath());
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QJsonDocument jsonDoc = QJsonDocument::fromJson(file.readAll());
+    if (!jsonDoc.isObject()) return;
+
+    QJsonObject jsonObj = jsonDoc.object();
+    const QJsonArray itemsArray = jsonObj["items"].toArray();
+    for (const QJsonValue &value : itemsArray) {
+        QJsonObject itemObj = value.toObject();
+        UploadItem item;
+        item.id = m_nextId++;
+        item.filePath = itemObj["file_path"].toString();
+        item.name = QFileInfo(item.filePath).fileName();
+        item.state = static_cast<UploadItem::State>(itemObj["state"].toInt(UploadItem::Queued));
+        item.bytesTotal = itemObj["bytes_total"].toInteger();
+        item.errorString = itemObj["error"].toString();
+        item.serverFilename = itemObj["server_filename"].toString();
+
+        if (item.filePath.isEmpty()) continue;
+        if (item.state < UploadItem::Queued || item.state > UploadItem::Failed) { item.state = UploadItem::Queued; }
+        if (item.isActive()) { item.state = UploadItem::Queued; }
+        if (item.state == UploadItem::Completed) { item.bytesSent = item.bytesTotal; }
+        m_items.append(item);
+    }
+
+    // 关闭期间出现的文件无法区分是否已处理，与开始监视时一样视为已存在
+    QString watchFolder = jsonObj["watch_folder"].toString();
+    if (!watchFolder.isEmpty() && QFileInfo(watchFolder).isDir()) { setWatchFolder(watchFolder); }
+}
+
+void UploadManager::save()
+{
+    m_saveTimer.start();
+}
+
+// 写入队列文件
+void UploadManager::writeQueueFile()
+{
+    m_saveTimer.stop();
+
+    QJsonArray itemsArray;
+    for (const UploadItem &item : m_items) {
+        QJsonObject itemObj;
+        itemObj["file_path"] = item.filePath;
+        itemObj["state"] = static_cast<int>(item.state);
+        itemObj["bytes_total"] = item.bytesTotal;
+        itemObj["error"] = item.errorString;
+        itemObj["server_filename"] = item.serverFilename;
+        itemsArray.append(itemObj);
+    }
+
+    QJsonObject jsonObj;
+    jsonObj["watch_folder"] = m_watchFolder;
+    jsonObj["items"] = itemsArray;
+
+    QDir().mkpath(QFileInfo(queueFilePath()).absolutePath());
+    QSaveFile file(queueFilePath());
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(QJsonDocument(jsonObj).toJson(QJsonDocument::Compact));
+    file.commit();
+}
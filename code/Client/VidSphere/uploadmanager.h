@@ -0,0 +1,135 @@
+//uploadmanager.h
+//上传管理器：批量上传队列，多选文件、整个文件夹或监视文件夹中新出现的视频都加入这里
+//流水线调度：最多kMaxTransfers个文件同时传输，同时另有kLookahead个文件在后台分析（MP4改写、分块哈希、缩略图），
+//一个文件传完时下一个通常已经分析好，磁盘、CPU和网络同时忙碌
+//队列和监视文件夹保存在应用数据目录的 uploads.json 中，客户端重启后未完成的上传继续
+
+#pragma once
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+class ChunkedUpload;
+
+// 上传项及其状态
+struct UploadItem
+{
+    enum State {
+        Queued,     // 等待调度
+        Analyzing,  // 后台分析文件
+        Waiting,    // 分析完成，等待传输名额
+        Uploading,  // 正在传输
+        Completed,  // 已完成
+        Failed      // 出错，可重试
+    };
+
+    int id = 0;
+    QString name;
+    QString filePath;
+    State state = Queued;
+    qint64 bytesHashed = 0;
+    qint64 bytesSent = 0;
+    qint64 bytesTotal = 0;   // 上传数据流的长度，开始前为文件大小
+    qint64 bytesSkipped = 0; // 服务器已有、无需上传的字节数
+    double speed = 0;        // 字节/秒
+    QString errorString;
+    QString serverFilename;  // 服务器上保存的文件名
+
+    bool isActive() const { return state != Completed && state != Failed; }
+};
+
+class UploadManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UploadManager(QNetworkAccessManager *manager, QObject *parent = nullptr);
+    ~UploadManager();
+
+    // 未连接服务器时只排队，设置地址后开始上传
+    void setServerAddress(const QString &serverAddress);
+
+    // 加入队列，同一文件未完成时返回已有的id
+    int enqueue(const QString &filePath);
+    int enqueueFiles(const QStringList &filePaths);   // 返回新加入的个数
+
+    void retry(int id);      // 失败的上传重新排队
+    void cancel(int id);     // 取消并从列表中移除，已确认的块保留在服务器上
+    void clearFinished();
+
+    // 监视文件夹：之后新出现且写入完成的视频自动上传，空字符串停止监视
+    bool setWatchFolder(const QString &folderPath);
+    QString getWatchFolder() const { return m_watchFolder; }
+
+    QList<UploadItem> getItems() const { return m_items; }
+    const UploadItem *getItem(int id) const;
+    int getRunningCount() const;    // 正在传输
+    int getAnalyzingCount() const;  // 正在分析或等待传输
+    int getQueuedCount() const;
+    double getTotalSpeed() const;
+    qint64 getRemainingBytes() const;
+    qint64 getEtaSeconds() const;   // 按当前总速度估算全部传完的秒数，无法估算时为-1
+
+    static bool isVideoFile(const QString &filePath);
+    static QStringList listVideoFiles(const QString &folderPath, bool recursive);  // 按路径排序
+
+signals:
+    void itemAdded(int id);
+    void itemChanged(int id);
+    void itemRemoved(int id);
+    void itemFinished(int id, bool success);
+    void statsChanged();  // 各状态数量、总速度或剩余时间变化
+
+private slots:
+    void onSpeedTick();
+    void onDirectoryChanged();
+    void checkPendingFiles();
+
+private:
+    // 监视文件夹中出现、可能仍在写入的文件
+    struct PendingFile
+    {
+        qint64 size = -1;
+        qint64 lastModified = 0;
+        qint64 stableSince = 0;  // 大小和修改时间最后一次变化的时刻（毫秒）
+    };
+
+    UploadItem *findItem(int id);
+    void schedule();                  // 按加入顺序放行传输，补足后台分析的文件
+    void startItem(UploadItem &item);
+    void stopTask(int id);
+    void load();
+    void save();                      // 合并短时间内的多次修改后写盘
+    void writeQueueFile();
+    QString queueFilePath() const;
+
+    static constexpr int kMaxTransfers = 2;       // 同时传输的文件数，每个上传自己还有多块并发
+    static constexpr int kWindowBudget = 4;       // 所有上传共享的块并发数，给列表刷新和控制请求留出连接
+    static constexpr int kLookahead = 2;          // 传输之外提前分析的文件数
+    static constexpr int kDebounceMs = 2000;      // 目录变化合并
+    static constexpr int kStableMs = 5000;        // 大小和修改时间保持不变多久才认为写入完成
+    static constexpr int kCheckIntervalMs = 1000;
+
+    QNetworkAccessManager *m_manager;
+    QString m_serverAddress;
+    QList<UploadItem> m_items;                    // 按加入顺序排列
+    QHash<int, ChunkedUpload *> m_tasks;          // 正在分析或传输的上传
+    QHash<int, qint64> m_lastBytes;               // 上个统计周期的字节数
+    QTimer m_speedTimer;
+    QTimer m_saveTimer;
+    int m_nextId;
+
+    // 监视文件夹
+    QFileSystemWatcher m_watcher;
+    QString m_watchFolder;
+    QSet<QString> m_knownFiles;                   // 已处理过（或开始监视时已存在）的文件
+    QHash<QString, PendingFile> m_pendingFiles;
+    QTimer m_debounceTimer;
+    QTimer m_checkTimer;
+};
@@ -0,0 +1,191 @@
+//uploadmanagerdialog.cpp
+//上传列表窗口
+
+#include "uploadmanagerdialog.h"
+#include "uploadmanager.h"
+#include "downloadmanagerdialog.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QProgressBar>
+
+// 表格列
+enum UploadColumn {
+    NameColumn = 0,
+    StateColumn,
+    ProgressColumn,
+    SpeedColumn,
+    ColumnCount
+};
+
+// 初始化上传列表窗口
+UploadManagerDialog::UploadManagerDialog(UploadManager *manager, QWidget *parent)
+    : QDialog(parent)
+    , m_manager(manager)
+{
+    setWindowTitle("上传列表");
+    resize(680, 420);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    // 上传表格
+    m_table = new QTableWidget(0, ColumnCount, this);
+    m_table->setHorizontalHeaderLabels({"名称", "状态", "进度", "速度"});
+    m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_table->verticalHeader()->setVisible(false);
+    m_table->horizontalHeader()->setSectionResizeMode(NameColumn, QHeaderView::Stretch);
+    m_table->horizontalHeader()->setSectionResizeMode(ProgressColumn, QHeaderView::Fixed);
+    m_table->setColumnWidth(ProgressColumn, 180);
+    mainLayout->addWidget(m_table);
+
+    // 操作按钮
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    m_retryButton = new QPushButton("重试", this);
+    m_cancelButton = new QPushButton("取消", this);
+    QPushButton *clearButton = new QPushButton("清除已完成", this);
+    buttonLayout->addWidget(m_retryButton);
+    buttonLayout->addWidget(m_cancelButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(clearButton);
+    mainLayout->addLayout(buttonLayout);
+
+    // 监视文件夹和汇总信息
+    QHBoxLayout *bottomLayout = new QHBoxLayout();
+    m_watchLabel = new QLabel(this);
+    bottomLayout->addWidget(m_watchLabel);
+    bottomLayout->addStretch();
+    m_summaryLabel = new QLabel(this);
+    bottomLayout->addWidget(m_summaryLabel);
+    mainLayout->addLayout(bottomLayout);
+
+    // 按钮信号
+    connect(m_retryButton, &QPushButton::clicked, this, [this]() { m_manager->retry(selectedId()); });
+    connect(m_cancelButton, &QPushButton::clicked, this, [this]() { m_manager->cancel(selectedId()); });
+    connect(clearButton, &QPushButton::clicked, m_manager, &UploadManager::clearFinished);
+    connect(m_table, &QTableWidget::itemSelectionChanged, this, &UploadManagerDialog::onSelectionChanged);
+
+    // 上传管理器信号
+    connect(m_manager, &UploadManager::itemAdded, this, &UploadManagerDialog::onItemAdded);
+    connect(m_manager, &UploadManager::itemChanged, this, &UploadManagerDialog::onItemChanged);
+    connect(m_manager, &UploadManager::itemRemoved, this, &UploadManagerDialog::onItemRemoved);
+    connect(m_manager, &UploadManager::statsChanged, this, &UploadManagerDialog::onStatsChanged);
+
+    // 填充现有的上传
+    const QList<UploadItem> items = m_manager->getItems();
+    for (const UploadItem &item : items) { onItemAdded(item.id); }
+    onStatsChanged();
+    onSelectionChanged();
+}
+
+// 格式化剩余时间
+QString UploadManagerDialog::formatDuration(qint64 seconds)
+{
+    if (seconds < 0) return QString("--");
+    if (seconds >= 3600) return QString("%1小时%2分").arg(seconds / 3600).arg(seconds % 3600 / 60);
+    if (seconds >= 60) return QString("%1分%2秒").arg(seconds / 60).arg(seconds % 60);
+    return QString("%1秒").arg(seconds);
+}
+
+// 新增一行
+void UploadManagerDialog::onItemAdded(int id)
+{
+    int row = m_table->rowCount();
+    m_table->insertRow(row);
+
+    QTableWidgetItem *nameItem = new QTableWidgetItem();
+    nameItem->setData(Qt::UserRole, id);
+    m_table->setItem(row, NameColumn, nameItem);
+    m_table->setItem(row, StateColumn, new QTableWidgetItem());
+    m_table->setItem(row, SpeedColumn, new QTableWidgetItem());
+
+    QProgressBar *progressBar = new QProgressBar(m_table);
+    progressBar->setRange(0, 100);
+    m_table->setCellWidget(row, ProgressColumn, progressBar);
+
+    updateRow(row, id);
+}
+
+void UploadManagerDialog::onItemChanged(int id)
+{
+    int row = rowForId(id);
+    if (row >= 0) { updateRow(row, id); }
+    if (row == m_table->currentRow()) { onSelectionChanged(); }
+}
+
+void UploadManagerDialog::onItemRemoved(int id)
+{
+    int row = rowForId(id);
+    if (row >= 0) { m_table->removeRow(row); }
+}
+
+// 汇总：传输数、分析数、排队数、总速度、剩余时间
+void UploadManagerDialog::onStatsChanged()
+{
+    m_summaryLabel->setText(QString("上传中 %1 个，分析中 %2 个，排队 %3 个，总速度 %4，剩余 %5")
+                                .arg(m_manager->getRunningCount())
+                                .arg(m_manager->getAnalyzingCount())
+                                .arg(m_manager->getQueuedCount())
+                                .arg(DownloadManagerDialog::formatSpeed(m_manager->getTotalSpeed()))
+                                .arg(formatDuration(m_manager->getEtaSeconds())));
+
+    QString watchFolder = m_manager->getWatchFolder();
+    m_watchLabel->setText(watchFolder.isEmpty() ? QString() : "监视文件夹: " + watchFolder);
+}
+
+// 根据选中项的状态启用按钮
+void UploadManagerDialog::onSelectionChanged()
+{
+    const UploadItem *item = m_manager->getItem(selectedId());
+    bool hasItem = item != nullptr;
+    m_retryButton->setEnabled(hasItem && item->state == UploadItem::Failed);
+    m_cancelButton->setEnabled(hasItem);
+}
+
+int UploadManagerDialog::rowForId(int id) const
+{
+    for (int row = 0; row < m_table->rowCount(); ++row) {
+        if (m_table->item(row, NameColumn)->data(Qt::UserRole).toInt() == id) return row;
+    }
+    return -1;
+}
+
+int UploadManagerDialog::selectedId() const
+{
+    int row = m_table->currentRow();
+    if (row < 0 || !m_table->item(row, NameColumn)) return -1;
+    return m_table->item(row, NameColumn)->data(Qt::UserRole).toInt();
+}
+
+// 刷新一行的显示；分析阶段进度条显示哈希进度
+void UploadManagerDialog::updateRow(int row, int id)
+{
+    const UploadItem *item = m_manager->getItem(id);
+    if (!item) return;
+
+    static const QStringList stateNames = {"排队中", "分析中", "等待上传", "上传中", "已完成", "失败"};
+
+    m_table->item(row, NameColumn)->setText(item->name);
+    m_table->item(row, NameColumn)->setToolTip(item->filePath);
+
+    if (item->state == UploadItem::Failed && !item->errorString.isEmpty()) {
+        m_table->item(row, StateColumn)->setToolTip(item->errorString);
+    }
+    m_table->item(row, StateColumn)->setText(stateNames.value(item->state));
+
+    QProgressBar *progressBar = qobject_cast<QProgressBar *>(m_table->cellWidget(row, ProgressColumn));
+    if (progressBar) {
+        qint64 done = item->state == UploadItem::Analyzing ? item->bytesHashed : item->bytesSent;
+        int progress = item->bytesTotal > 0 ? static_cast<int>(done * 100 / item->bytesTotal) : 0;
+        progressBar->setValue(qBound(0, progress, 100));
+        progressBar->setFormat(item->bytesTotal > 0
+                                   ? QString("%1 / %2").arg(DownloadManagerDialog::formatSize(done),
+                                                            DownloadManagerDialog::formatSize(item->bytesTotal))
+                                   : QString("%p%"));
+    }
+
+    m_table->item(row, SpeedColumn)->setText(item->state == UploadItem::Uploading
+                                                 ? DownloadManagerDialog::formatSpeed(item->speed)
+                                                 : QString());
+}
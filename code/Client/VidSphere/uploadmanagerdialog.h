@@ -0,0 +1,40 @@
+//uploadmanagerdialog.h
+//上传列表窗口：显示每个上传的状态（分析、等待、传输）、进度和速度，汇总总速度和剩余时间，提供重试/取消
+
+#pragma once
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QPushButton>
+#include <QLabel>
+
+class UploadManager;
+
+class UploadManagerDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit UploadManagerDialog(UploadManager *manager, QWidget *parent = nullptr);
+
+    static QString formatDuration(qint64 seconds);
+
+private slots:
+    void onItemAdded(int id);
+    void onItemChanged(int id);
+    void onItemRemoved(int id);
+    void onStatsChanged();
+    void onSelectionChanged();
+
+private:
+    int rowForId(int id) const;
+    int selectedId() const;
+    void updateRow(int row, int id);
+
+    UploadManager *m_manager;
+    QTableWidget *m_table;
+    QPushButton *m_retryButton;
+    QPushButton *m_cancelButton;
+    QLabel *m_watchLabel;
+    QLabel *m_summaryLabel;
+};
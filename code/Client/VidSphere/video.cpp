@@ -102,9 +102,8 @@ void Video::setThumbnail(const QString &thumbnailUrl)
     painter.drawRect(0, 0, 183, 139);
     painter.drawText(placeholder.rect(), Qt::AlignCenter, "视频缩略图");
 
-    //setPixmap()设置缩略图显示
-    m_thumbnailPixmap = placeholder;
-    m_thumbnailLabel->setPixmap(m_thumbnailPixmap.scaled(184, 140, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    //setPixmap()设置缩略图显示，占位图按标签尺寸绘制，不需要再缩放；只由标签持有一份像素
+    m_thumbnailLabel->setPixmap(placeholder);
     m_thumbnailLoaded = true;
 }
 
@@ -48,7 +48,6 @@ private:
     QString m_author;
     QString m_thumbnailUrl;
     QString m_downloadUrl;
-    QPixmap m_thumbnailPixmap;
     QLabel *m_thumbnailLabel;
     QLabel *m_titleLabel;
     QLabel *m_authorLabel;
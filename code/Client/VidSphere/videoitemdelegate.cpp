@@ -0,0 +1,46 @@
+//videoitemdelegate.cpp
+//外观与原来每个视频一个控件时相同：灰色边框、浅灰底色的缩略图框，9像素的黑色名称
+
+#include "videoitemdelegate.h"
+
+#include <QPainter>
+#include <QPixmap>
+
+void VideoItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    painter->save();
+
+    const QRect cell = option.rect;
+    const QRect thumbnailRect(cell.x() + (cell.width() - kThumbnailSize.width()) / 2, cell.y() + 2,
+                              kThumbnailSize.width(), kThumbnailSize.height());
+    painter->fillRect(thumbnailRect, QColor(Qt::lightGray));
+
+    // 缩略图按逻辑尺寸居中，高像素比屏幕上不再缩放
+    const QPixmap pixmap = index.data(Qt::DecorationRole).value<QPixmap>();
+    if (!pixmap.isNull()) {
+        QRectF target(QPointF(0, 0), pixmap.deviceIndependentSize());
+        target.moveCenter(QRectF(thumbnailRect).center());
+        painter->drawPixmap(target, pixmap, QRectF(pixmap.rect()));
+    } else {
+        painter->setPen(Qt::black);
+        painter->drawText(thumbnailRect, Qt::AlignCenter, "视频");
+    }
+    painter->setPen(Qt::gray);
+    painter->drawRect(thumbnailRect.adjusted(0, 0, -1, -1));
+
+    // 名称放在缩略图下方的剩余空间，超出部分裁掉
+    const QRect nameRect(cell.x() + 2, thumbnailRect.bottom() + 6, cell.width() - 4, cell.bottom() - thumbnailRect.bottom() - 6);
+    QFont font = option.font;
+    font.setPixelSize(9);
+    painter->setFont(font);
+    painter->setPen(Qt::black);
+    painter->setClipRect(nameRect);
+    painter->drawText(nameRect, Qt::AlignHCenter | Qt::AlignTop | Qt::TextWordWrap, index.data(Qt::DisplayRole).toString());
+
+    painter->restore();
+}
+
+QSize VideoItemDelegate::sizeHint(const QStyleOptionViewItem &, const QModelIndex &) const
+{
+    return kCellSize;
+}
@@ -0,0 +1,22 @@
+//videoitemdelegate.h
+//视频网格的单元格：上方为缩略图（或占位图），下方为最多两行的名称
+//所有单元格同样大小，视图只为可见的单元格调用paint，不为每个视频创建控件
+
+#pragma once
+
+#include <QStyledItemDelegate>
+#include <QSize>
+
+class VideoItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    static constexpr QSize kCellSize{120, 120};
+    static constexpr QSize kThumbnailSize{116, 90};
+
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
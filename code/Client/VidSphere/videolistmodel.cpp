@@ -0,0 +1,290 @@
+//videolistmodel.cpp
+//增删行时预取范围内的行号随之平移，加载回调按上下文查找当前行号；列表重置时所有回调上下文一起删除
+//差异只修改变化的行，但QList中间插入删除仍会移动后面的元素，每个视频不到200字节，十万个也只是一次内存移动
+
+#include "videolistmodel.h"
+#include "thumbnailloader.h"
+#include "blurhash.h"
+
+#include <QImage>
+#include <QUrl>
+#include <algorithm>
+
+VideoListModel::VideoListModel(ThumbnailLoader *loader, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_loader(loader)
+    , m_dpr(1.0)
+    , m_revision(0)
+{
+}
+
+int VideoListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_videos.size();
+}
+
+QVariant VideoListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_videos.size()) return QVariant();
+    const Video &video = m_videos.at(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        return video.name;
+    case Qt::DecorationRole: {
+        // 预取范围外的行没有像素，委托画"视频"文字；这些行本来也不在屏幕上
+        auto it = m_pixmaps.constFind(index.row());
+        return it == m_pixmaps.cend() ? QVariant() : QVariant(*it);
+    }
+    case UrlRole:
+        return video.url;
+    case DownloadUrlRole:
+        return video.downloadUrl;
+    case AuthorRole:
+        return video.author;
+    default:
+        return QVariant();
+    }
+}
+
+void VideoListModel::setVideos(const QList<Video> &videos)
+{
+    beginResetModel();
+    releaseAll();
+    m_videos = videos;
+    ++m_revision;
+    endResetModel();
+}
+
+void VideoListModel::appendVideos(const QList<Video> &videos)
+{
+    if (videos.isEmpty()) return;
+    beginInsertRows(QModelIndex(), m_videos.size(), m_videos.size() + videos.size() - 1);
+    m_videos.append(videos);
+    ++m_revision;
+    endInsertRows();
+}
+
+void VideoListModel::clear()
+{
+    setVideos(QList<Video>());
+}
+
+VideoListModel::Diff VideoListModel::diff(const QList<Video> &current, const QList<Video> &videos)
+{
+    Diff result;
+    result.videos = videos;
+
+    QHash<QString, int> currentRows;
+    currentRows.reserve(current.size());
+    for (int i = 0; i < current.size(); ++i) currentRows.insert(current.at(i).name, i);
+
+    // 新列表每一行在当前列表中的行号，-1为新增
+    QList<int> sourceRows(videos.size(), -1);
+    for (int i = 0; i < videos.size(); ++i) sourceRows[i] = currentRows.value(videos.at(i).name, -1);
+
+    // sourceRows的最长递增子序列即保持相对顺序、原地保留的行，O(n log n)
+    // tails[k]为长度k+1的子序列中末尾最小的那个（新列表中的行），previous用于回溯
+    QList<int> tails;
+    QList<int> previous(videos.size(), -1);
+    for (int i = 0; i < videos.size(); ++i) {
+        if (sourceRows.at(i) < 0) continue;
+        auto it = std::lower_bound(tails.begin(), tails.end(), sourceRows.at(i),
+                                   [&](int row, int source) { return sourceRows.at(row) < source; });
+        if (it != tails.begin()) previous[i] = *(it - 1);
+        if (it == tails.end()) {
+            tails.append(i);
+        } else {
+            *it = i;
+        }
+    }
+    QList<bool> keptNew(videos.size(), false);
+    QList<bool> keptCurrent(current.size(), false);
+    for (int i = tails.isEmpty() ? -1 : tails.last(); i >= 0; i = previous.at(i)) {
+        keptNew[i] = true;
+        keptCurrent[sourceRows.at(i)] = true;
+    }
+
+    // 删除：当前列表中未保留的连续行合并为一段，从后往前
+    for (int end = current.size(); end > 0;) {
+        if (keptCurrent.at(end - 1)) {
+            --end;
+            continue;
+        }
+        int begin = end - 1;
+        while (begin > 0 && !keptCurrent.at(begin - 1)) --begin;
+        result.removed.append({begin, end - begin});
+        end = begin;
+    }
+
+    // 插入与更新：删除后剩下的正是保留的行，按新列表的行号从前往后插入即得到新列表
+    for (int i = 0; i < videos.size();) {
+        if (keptNew.at(i)) {
+            if (!(videos.at(i) == current.at(sourceRows.at(i)))) result.updated.append({i, videos.at(i)});
+            ++i;
+            continue;
+        }
+        int end = i + 1;
+        while (end < videos.size() && !keptNew.at(end)) ++end;
+        result.inserted.append({i, videos.mid(i, end - i)});
+        i = end;
+    }
+    return result;
+}
+
+int VideoListModel::Diff::mapRow(int row) const
+{
+    // removed从后往前，被删除的段都在row之前时减去其行数
+    for (const QPair<int, int> &range : removed) {
+        if (row >= range.first + range.second) {
+            row -= range.second;
+        } else if (row >= range.first) {
+            return -1;
+        }
+    }
+    for (const QPair<int, QList<Video>> &range : inserted) {
+        if (range.first > row) break;
+        row += range.second.size();
+    }
+    return row;
+}
+
+void VideoListModel::applyDiff(const Diff &diff, quint64 revision)
+{
+    if (revision != m_revision) {
+        setVideos(diff.videos);
+        return;
+    }
+    if (diff.isEmpty()) return;
+
+    for (const QPair<int, int> &range : diff.removed) {
+        beginRemoveRows(QModelIndex(), range.first, range.first + range.second - 1);
+        for (int row = range.first; row < range.first + range.second; ++row) {
+            if (m_requests.contains(row)) releaseThumbnail(row);
+        }
+        m_videos.remove(range.first, range.second);
+        shiftRows(range.first + range.second, -range.second);
+        endRemoveRows();
+    }
+
+    for (const QPair<int, QList<Video>> &range : diff.inserted) {
+        const int count = range.second.size();
+        beginInsertRows(QModelIndex(), range.first, range.first + count - 1);
+        m_videos.insert(range.first, count, Video());
+        std::copy(range.second.cbegin(), range.second.cend(), m_videos.begin() + range.first);
+        shiftRows(range.first, count);
+        endInsertRows();
+    }
+
+    // 缩略图或占位图有变化且在预取范围内的行重新加载
+    for (const QPair<int, Video> &update : diff.updated) {
+        const int row = update.first;
+        const bool reload = m_requests.contains(row)
+                            && (m_videos.at(row).thumbnail != update.second.thumbnail
+                                || m_videos.at(row).blurhash != update.second.blurhash);
+        if (reload) releaseThumbnail(row);
+        m_videos[row] = update.second;
+        if (reload) loadThumbnail(row);
+        const QModelIndex modelIndex = index(row);
+        emit dataChanged(modelIndex, modelIndex);
+    }
+
+    ++m_revision;
+}
+
+void VideoListModel::setThumbnailSize(const QSize &size, qreal dpr)
+{
+    if (size == m_thumbnailSize && qFuzzyCompare(dpr, m_dpr)) return;
+    m_thumbnailSize = size;
+    m_dpr = dpr;
+
+    // 已在范围内的行按新尺寸重新加载，优先级等下次更新范围时再设置
+    const QList<int> rows = m_requests.keys();
+    releaseAll();
+    for (int row : rows) loadThumbnail(row);
+}
+
+void VideoListModel::setNearRows(const QHash<int, int> &priorities)
+{
+    const QList<int> rows = m_requests.keys();
+    for (int row : rows) {
+        if (!priorities.contains(row)) releaseThumbnail(row);
+    }
+
+    for (auto it = priorities.cbegin(); it != priorities.cend(); ++it) {
+        if (it.key() < 0 || it.key() >= m_videos.size()) continue;
+        if (!m_requests.contains(it.key())) loadThumbnail(it.key());
+        if (QObject *context = m_requests.value(it.key())) m_loader->setPriority(context, it.value());
+    }
+}
+
+// 先显示列表中附带的模糊占位图，缩略图到达后替换；没有缩略图的行也记为在范围内，避免重复解码占位图
+void VideoListModel::loadThumbnail(int row)
+{
+    const Video &video = m_videos.at(row);
+    const QModelIndex modelIndex = index(row);
+
+    if (!video.blurhash.isEmpty()) {
+        // 只有低频分量，解码成与缩略图同比例的小图后平滑放大
+        QImage image = BlurHash::decode(video.blurhash, 32, 18);
+        if (!image.isNull()) {
+            m_pixmaps.insert(row, QPixmap::fromImage(
+                image.scaled(m_thumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation)));
+            emit dataChanged(modelIndex, modelIndex, {Qt::DecorationRole});
+        }
+    }
+
+    if (video.thumbnail.isEmpty() || m_thumbnailSize.isEmpty()) {
+        m_requests.insert(row, nullptr);
+        return;
+    }
+
+    // 内存中有时会立即回调，所以先登记再请求
+    QObject *context = new QObject(this);
+    m_requests.insert(row, context);
+    m_loader->load(QUrl(video.thumbnail), m_thumbnailSize, m_dpr, context, [this, context](const QPixmap &pixmap) {
+        if (pixmap.isNull()) return; // 失败时保留占位图
+        const int row = m_requests.key(context, -1); // 请求期间前面可能插入或删除了行
+        if (row < 0) return;
+        m_pixmaps.insert(row, pixmap);
+        const QModelIndex modelIndex = index(row);
+        emit dataChanged(modelIndex, modelIndex, {Qt::DecorationRole});
+    });
+}
+
+void VideoListModel::releaseThumbnail(int row)
+{
+    if (QObject *context = m_requests.take(row)) {
+        m_loader->cancel(context);
+        delete context;
+    }
+    m_pixmaps.remove(row);
+}
+
+void VideoListModel::releaseAll()
+{
+    for (QObject *context : std::as_const(m_requests)) {
+        if (!context) continue;
+        m_loader->cancel(context);
+        delete context;
+    }
+    m_requests.clear();
+    m_pixmaps.clear();
+}
+
+// from及之后的行号加上delta（预取范围内只有几百行）
+void VideoListModel::shiftRows(int from, int delta)
+{
+    QHash<int, QObject *> requests;
+    for (auto it = m_requests.cbegin(); it != m_requests.cend(); ++it) {
+        requests.insert(it.key() >= from ? it.key() + delta : it.key(), it.value());
+    }
+    m_requests = requests;
+
+    QHash<int, QPixmap> pixmaps;
+    for (auto it = m_pixmaps.cbegin(); it != m_pixmaps.cend(); ++it) {
+        pixmaps.insert(it.key() >= from ? it.key() + delta : it.key(), it.value());
+    }
+    m_pixmaps = pixmaps;
+}
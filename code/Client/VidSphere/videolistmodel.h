@@ -0,0 +1,89 @@
+//videolistmodel.h
+//视频列表模型：每个视频只保存几段字符串，十万个视频也只占几十MB，视图只为可见的单元格取数据
+//缩略图只为预取范围内的行加载，像素按行号保存，行离开范围后取消请求并丢弃，只留加载服务中的压缩数据
+//刷新时按文件名与新列表比较，只增删、更新有变化的行，其余行的缩略图不受影响
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+
+class ThumbnailLoader;
+
+class VideoListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    struct Video
+    {
+        QString name;
+        QString url;         // 播放地址，相对服务器
+        QString downloadUrl;
+        QString author;
+        QString thumbnail;   // 完整的缩略图URL，可以为空
+        QString blurhash;    // 缩略图的模糊占位，旧服务器没有
+
+        bool operator==(const Video &other) const = default;
+    };
+
+    // 从当前列表到新列表的修改：先按顺序删除，再按顺序插入，最后更新内容
+    struct Diff
+    {
+        QList<QPair<int, int>> removed;           // 当前列表中的 (起始行, 行数)，从后往前
+        QList<QPair<int, QList<Video>>> inserted; // 新列表中的起始行和连续插入的视频，从前往后
+        QList<QPair<int, Video>> updated;         // 新列表中的行和新内容
+        QList<Video> videos;                      // 新列表，计算期间模型被修改时整体替换
+
+        bool isEmpty() const { return removed.isEmpty() && inserted.isEmpty() && updated.isEmpty(); }
+        // 当前列表中的行在新列表中的位置，被删除时为-1
+        int mapRow(int row) const;
+    };
+
+    enum Role {
+        UrlRole = Qt::UserRole + 1,
+        DownloadUrlRole,
+        AuthorRole
+    };
+
+    explicit VideoListModel(ThumbnailLoader *loader, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void setVideos(const QList<Video> &videos);
+    void appendVideos(const QList<Video> &videos); // 分页加载的下一页接在末尾
+    void clear();
+    const Video &getVideo(int row) const { return m_videos.at(row); }
+    const QList<Video> &getVideos() const { return m_videos; }
+    quint64 getRevision() const { return m_revision; }  // 每次修改列表后加1
+
+    // 按名称匹配计算差异，只读参数，可以在工作线程中调用；保持顺序的视频取最长的一组，其余视为删除后插入
+    static Diff diff(const QList<Video> &current, const QList<Video> &videos);
+    // revision为计算差异时的getRevision()，之后列表又被修改过则整体替换为diff.videos
+    void applyDiff(const Diff &diff, quint64 revision);
+
+    // 缩略图的显示尺寸（逻辑像素）和屏幕像素比，改变后已加载的缩略图全部重新请求
+    void setThumbnailSize(const QSize &size, qreal dpr);
+
+    // 预取范围内的行及其优先级（与视口的距离，越小越先加载）；不在其中的行取消请求、丢弃像素
+    void setNearRows(const QHash<int, int> &priorities);
+
+private:
+    void loadThumbnail(int row);
+    void releaseThumbnail(int row);
+    void releaseAll();
+    void shiftRows(int from, int delta);
+
+    ThumbnailLoader *m_loader;
+    QList<Video> m_videos;
+    QSize m_thumbnailSize;
+    qreal m_dpr;
+    quint64 m_revision;
+    QHash<int, QObject *> m_requests; // 预取范围内的行 -> 加载回调的上下文（没有缩略图时为空），删除后回调不再执行
+    QHash<int, QPixmap> m_pixmaps;    // 预取范围内的行已有的占位图或缩略图
+};
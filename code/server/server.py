@@ -6,6 +6,15 @@ from datetime import datetime
 from collections import deque
 import io
 import sys
+import json
+import threading
+import re
+import uuid
+import hashlib
+import sqlite3
+import base64
+import math
+import bisect
 
 # 使用绝对路径确保正确找到模板
 BASE_DIR = os.path.dirname(os.path.abspath(__file__))
@@ -14,8 +23,50 @@ TEMPLATE_DIR = os.path.join(BASE_DIR, 'ui')
 app = Flask(__name__, template_folder=TEMPLATE_DIR)
 UPLOAD_FOLDER = os.path.join(BASE_DIR, 'videos')
 THUMBNAIL_FOLDER = os.path.join(BASE_DIR, 'thumbnails')
+DIGEST_FOLDER = os.path.join(BASE_DIR, 'digests')
+STAGING_FOLDER = os.path.join(BASE_DIR, 'staging')
+CHUNK_STAGING_FOLDER = os.path.join(BASE_DIR, 'chunk_staging')
+CHUNK_INDEX_PATH = os.path.join(BASE_DIR, 'chunks.db')
+METADATA_FOLDER = os.path.join(BASE_DIR, 'metadata')
+THUMBNAIL_VARIANT_FOLDER = os.path.join(THUMBNAIL_FOLDER, 'variants')
 os.makedirs(UPLOAD_FOLDER, exist_ok=True)
 os.makedirs(THUMBNAIL_FOLDER, exist_ok=True)
+os.makedirs(DIGEST_FOLDER, exist_ok=True)
+os.makedirs(STAGING_FOLDER, exist_ok=True)
+os.makedirs(CHUNK_STAGING_FOLDER, exist_ok=True)
+os.makedirs(METADATA_FOLDER, exist_ok=True)
+os.makedirs(THUMBNAIL_VARIANT_FOLDER, exist_ok=True)
+
+# 客户端附带的缩略图大小上限
+MAX_CLIENT_THUMBNAIL_SIZE = 512 * 1024
+
+# 缩略图占位图：BlurHash的横向、纵向分量数，计算前先缩小到这个尺寸
+BLURHASH_COMPONENTS = (4, 3)
+BLURHASH_SAMPLE_SIZE = (32, 18)
+BLURHASH_CHARACTERS = '0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz#$%*+,-.:;=?@[]^_{|}~'
+
+# 缩略图拼图：一次最多拼接的缩略图数量和单格尺寸上限
+MAX_ATLAS_TILES = 64
+MAX_ATLAS_TILE_SIZE = (320, 180)
+
+# 指定尺寸的缩略图：客户端按显示尺寸乘以设备像素比请求，结果缓存在 thumbnails/variants 中
+MIN_PREVIEW_VARIANT_SIZE = 16
+MAX_PREVIEW_VARIANT_SIZE = (640, 360)
+MAX_PREVIEW_DPR = 4.0
+# 缩放后的缩略图只生成这几档尺寸，取能容纳请求尺寸的最小一档，每个缩略图最多生成这么多个版本
+PREVIEW_VARIANT_SIZES = ((80, 45), (120, 68), (160, 90), (240, 135), (320, 180), (480, 270), (640, 360))
+
+# 视频列表分页：每页的默认和最多视频数；不带limit和cursor的请求仍返回全部视频
+VIDEO_PAGE_DEFAULT_SIZE = 100
+MAX_VIDEO_PAGE_SIZE = 500
+VIDEO_EXTENSIONS = ('.mp4', '.avi', '.mov', '.mkv', '.wmv', '.flv', '.webm')
+video_catalog_lock = threading.Lock()
+video_catalog = {'folder_mtime': None, 'times': {}, 'entries': []}
+
+# 分块上传的块大小和未完成会话的保留时间
+UPLOAD_CHUNK_SIZE = 8 * 1024 * 1024
+UPLOAD_SESSION_MAX_AGE = 7 * 24 * 3600
+upload_sessions_lock = threading.Lock()
 
 # 存储连接信息的队列，最多保存100条记录
 connection_history = deque(maxlen=100)
@@ -40,6 +91,34 @@ except ImportError as e:
     print("   将使用默认缩略图")
     from PIL import Image, ImageDraw
 
+# Pillow编译时可能不带WebP，此时只输出JPEG
+from PIL import features as pil_features
+WEBP_AVAILABLE = pil_features.check('webp')
+
+# 尝试导入CRC32C库（C实现，用于下载校验），没有时下载不带校验值
+try:
+    import google_crc32c
+
+    def crc32c_update(crc, data):
+        return google_crc32c.extend(crc, data)
+
+    CRC32C_AVAILABLE = True
+except ImportError:
+    try:
+        import crc32c as crc32c_module
+
+        def crc32c_update(crc, data):
+            return crc32c_module.crc32c(data, crc)
+
+        CRC32C_AVAILABLE = True
+    except ImportError:
+        CRC32C_AVAILABLE = False
+        print(" 未安装 google-crc32c 或 crc32c，下载将不提供校验值")
+
+# 正在后台计算校验值的文件
+digest_jobs_in_progress = set()
+digest_jobs_lock = threading.Lock()
+
 
 def add_notification(message, level='info'):
     """添加一条通知消息"""
@@ -52,6 +131,154 @@ def add_notification(message, level='info'):
     print(f"日志: {message}")
 
 
+def srgb_to_linear(value):
+    v = value / 255
+    return v / 12.92 if v <= 0.04045 else ((v + 0.055) / 1.055) ** 2.4
+
+
+def linear_to_srgb(value):
+    v = max(0.0, min(1.0, value))
+    if v <= 0.0031308:
+        return int(v * 12.92 * 255 + 0.5)
+    return int((1.055 * v ** (1 / 2.4) - 0.055) * 255 + 0.5)
+
+
+def encode_base83(value, length):
+    return ''.join(BLURHASH_CHARACTERS[value // 83 ** (length - 1 - i) % 83] for i in range(length))
+
+
+def encode_blurhash(image):
+    """把图片编码为BlurHash：几个余弦分量的颜色，约20个字符，客户端解码成模糊的预览图"""
+    components_x, components_y = BLURHASH_COMPONENTS
+    width, height = BLURHASH_SAMPLE_SIZE
+    pixels = [[srgb_to_linear(c) for c in pixel] for pixel in image.convert('RGB').resize((width, height)).getdata()]
+
+    factors = []
+    for j in range(components_y):
+        for i in range(components_x):
+            normalisation = 1 if i == 0 and j == 0 else 2
+            r = g = b = 0.0
+            for y in range(height):
+                basis_y = math.cos(math.pi * j * y / height)
+                for x in range(width):
+                    basis = normalisation * math.cos(math.pi * i * x / width) * basis_y
+                    pixel = pixels[y * width + x]
+                    r += basis * pixel[0]
+                    g += basis * pixel[1]
+                    b += basis * pixel[2]
+            scale = 1 / (width * height)
+            factors.append((r * scale, g * scale, b * scale))
+
+    dc, ac = factors[0], factors[1:]
+    result = encode_base83((components_x - 1) + (components_y - 1) * 9, 1)
+
+    max_value = max((abs(c) for factor in ac for c in factor), default=0)
+    quantised_max = max(0, min(82, int(math.floor(max_value * 166 - 0.5))))
+    max_value = (quantised_max + 1) / 166
+    result += encode_base83(quantised_max, 1)
+
+    result += encode_base83((linear_to_srgb(dc[0]) << 16) + (linear_to_srgb(dc[1]) << 8) + linear_to_srgb(dc[2]), 4)
+    for factor in ac:
+        quantised = [max(0, min(18, int(math.floor(math.copysign(abs(c / max_value) ** 0.5, c) * 9 + 9.5))))
+                     for c in factor]
+        result += encode_base83(quantised[0] * 19 * 19 + quantised[1] * 19 + quantised[2], 2)
+    return result
+
+
+def placeholder_path_for(thumbnail_path):
+    return os.path.splitext(thumbnail_path)[0] + '.blurhash'
+
+
+def store_thumbnail_placeholder(thumbnail_path):
+    """缩略图生成后计算一次占位图，保存在缩略图旁边，返回BlurHash字符串"""
+    try:
+        with Image.open(thumbnail_path) as image:
+            blurhash = encode_blurhash(image)
+        with open(placeholder_path_for(thumbnail_path), 'w') as f:
+            f.write(blurhash)
+        return blurhash
+    except Exception as e:
+        print(f"计算占位图失败: {thumbnail_path}: {e}")
+        return None
+
+
+def load_thumbnail_placeholder(thumbnail_path):
+    """读取缩略图的占位图；旧缩略图没有时补算一次"""
+    placeholder_path = placeholder_path_for(thumbnail_path)
+    try:
+        if os.path.getmtime(placeholder_path) >= os.path.getmtime(thumbnail_path):
+            with open(placeholder_path) as f:
+                return f.read().strip()
+    except OSError:
+        pass
+    if os.path.exists(thumbnail_path):
+        return store_thumbnail_placeholder(thumbnail_path)
+    return None
+
+
+def parse_preview_variant_size(args):
+    """
+    解析 /preview 的 w、h、dpr 参数，返回能容纳实际像素尺寸的最小一档 (宽, 高)；没有给出w和h时返回None，使用原缩略图
+    参数不合法时抛出ValueError
+    """
+    if 'w' not in args and 'h' not in args:
+        return None
+    dpr = float(args.get('dpr', 1))
+    if not (0 < dpr <= MAX_PREVIEW_DPR):
+        raise ValueError('dpr')
+    width = int(round(int(args.get('w', args.get('h'))) * dpr))
+    height = int(round(int(args.get('h', args.get('w'))) * dpr))
+    width = min(max(width, MIN_PREVIEW_VARIANT_SIZE), MAX_PREVIEW_VARIANT_SIZE[0])
+    height = min(max(height, MIN_PREVIEW_VARIANT_SIZE), MAX_PREVIEW_VARIANT_SIZE[1])
+    for bucket in PREVIEW_VARIANT_SIZES:
+        if bucket[0] >= width and bucket[1] >= height:
+            return bucket
+    return MAX_PREVIEW_VARIANT_SIZE
+
+
+def get_thumbnail_variant(thumbnail_path, size, use_webp):
+    """
+    返回缩放到size以内（保持比例，不放大）的缩略图文件路径和MIME类型
+    缩略图比缓存的版本新时重新生成；写临时文件后改名，并发请求不会读到写了一半的文件
+    """
+    extension, mimetype, image_format = ('webp', 'image/webp', 'WEBP') if use_webp else ('jpg', 'image/jpeg', 'JPEG')
+    name = os.path.splitext(os.path.basename(thumbnail_path))[0]
+    variant_path = os.path.join(THUMBNAIL_VARIANT_FOLDER, f"{name}.{size[0]}x{size[1]}.{extension}")
+    try:
+        if os.path.getmtime(variant_path) >= os.path.getmtime(thumbnail_path):
+            return variant_path, mimetype
+    except OSError:
+        pass
+
+    with Image.open(thumbnail_path) as image:
+        image.draft('RGB', size)  # JPEG在解码时按1/2、1/4、1/8缩小
+        variant = image.convert('RGB')
+        variant.thumbnail(size, Image.LANCZOS)
+    temporary_path = f"{variant_path}.{uuid.uuid4().hex}.tmp"
+    if use_webp:
+        variant.save(temporary_path, format=image_format, quality=80, method=4)
+    else:
+        variant.save(temporary_path, format=image_format, quality=85, optimize=True, progressive=True)
+    os.replace(temporary_path, variant_path)
+    return variant_path, mimetype
+
+
+def send_thumbnail(thumbnail_path):
+    """
+    发送缩略图，请求带w/h/dpr时发送对应尺寸的版本；Accept中有image/webp且Pillow支持时输出WebP
+    带ETag和Last-Modified，客户端缓存重新请求时未变化只返回304
+    """
+    size = parse_preview_variant_size(request.args)
+    if size is None:
+        return send_file(thumbnail_path, mimetype='image/jpeg', conditional=True, etag=True, max_age=0)
+
+    use_webp = WEBP_AVAILABLE and request.accept_mimetypes['image/webp'] > 0
+    variant_path, mimetype = get_thumbnail_variant(thumbnail_path, size, use_webp)
+    response = send_file(variant_path, mimetype=mimetype, conditional=True, etag=True, max_age=0)
+    response.vary.add('Accept')
+    return response
+
+
 def generate_video_thumbnail(video_path, thumbnail_path, thumbnail_size=(320, 180)):
     """使用OpenCV生成视频缩略图"""
     if not CV_AVAILABLE:
@@ -98,8 +325,10 @@ def generate_video_thumbnail(video_path, thumbnail_path, thumbnail_size=(320, 18
         # 调整大小
         frame_resized = cv2.resize(frame_rgb, thumbnail_size, interpolation=cv2.INTER_AREA)
 
-        # 保存为JPEG
-        cv2.imwrite(thumbnail_path, frame_resized)
+        # 保存为渐进式JPEG：客户端收到第一个扫描就能显示模糊的整张预览，之后逐步变清晰
+        cv2.imwrite(thumbnail_path, frame_resized,
+                    [cv2.IMWRITE_JPEG_QUALITY, 90, cv2.IMWRITE_JPEG_PROGRESSIVE, 1, cv2.IMWRITE_JPEG_OPTIMIZE, 1])
+        store_thumbnail_placeholder(thumbnail_path)
         print(f"缩略图生成成功: {thumbnail_path} ({thumbnail_size[0]}x{thumbnail_size[1]})")
         return True
 
@@ -108,6 +337,118 @@ def generate_video_thumbnail(video_path, thumbnail_path, thumbnail_size=(320, 18
         return generate_default_thumbnail(thumbnail_path, thumbnail_size)
 
 
+def save_client_sidecar(filename, thumbnail_data, metadata):
+    """保存客户端随视频上传的缩略图和元数据，缩略图有效时返回True"""
+    stored_thumbnail = False
+    if thumbnail_data and len(thumbnail_data) <= MAX_CLIENT_THUMBNAIL_SIZE and thumbnail_data[:3] == b'\xff\xd8\xff':
+        thumbnail_path = os.path.join(THUMBNAIL_FOLDER, filename + '.jpg')
+        temp_path = thumbnail_path + '.tmp'
+        with open(temp_path, 'wb') as f:
+            f.write(thumbnail_data)
+        os.replace(temp_path, thumbnail_path)
+        store_thumbnail_placeholder(thumbnail_path)
+        stored_thumbnail = True
+
+    # 只保留认识的字段
+    if isinstance(metadata, dict):
+        fields = {key: metadata[key] for key in ('duration_ms', 'width', 'height')
+                  if isinstance(metadata.get(key), int) and not isinstance(metadata.get(key), bool) and metadata[key] >= 0}
+        if fields:
+            with open(os.path.join(METADATA_FOLDER, filename + '.json'), 'w') as f:
+                json.dump(fields, f)
+    return stored_thumbnail
+
+
+def store_upload_thumbnail(filename, video_path, thumbnail_data, metadata):
+    """客户端附带了缩略图时直接保存，否则在服务器上用OpenCV生成"""
+    thumbnail_filename = filename + '.jpg'
+    if save_client_sidecar(filename, thumbnail_data, metadata):
+        add_notification(f"已保存客户端生成的缩略图: {thumbnail_filename}", "info")
+    elif generate_video_thumbnail(video_path, os.path.join(THUMBNAIL_FOLDER, thumbnail_filename)):
+        add_notification(f"已生成缩略图: {thumbnail_filename}", "info")
+    else:
+        add_notification("缩略图生成失败，使用默认缩略图", "warning")
+
+
+def parse_sidecar_params(params):
+    """从JSON请求体取出缩略图（base64）和元数据"""
+    thumbnail_data = None
+    try:
+        if isinstance(params.get('thumbnail'), str):
+            thumbnail_data = base64.b64decode(params['thumbnail'], validate=True)
+    except ValueError:
+        thumbnail_data = None
+    return thumbnail_data, params.get('metadata')
+
+
+def compute_file_crc32c(video_path, digest_path):
+    """读取整个文件计算CRC32C，结果连同文件大小和修改时间写入digests目录"""
+    stat = os.stat(video_path)
+    crc = 0
+    with open(video_path, 'rb') as f:
+        while True:
+            block = f.read(1024 * 1024)
+            if not block:
+                break
+            crc = crc32c_update(crc, block)
+
+    digest = f"{crc:08x}"
+    save_file_crc32c(video_path, digest_path, digest, stat)
+    return digest
+
+
+def save_file_crc32c(video_path, digest_path, digest, stat=None):
+    """保存校验值，记录文件大小和修改时间用于判断缓存是否失效"""
+    if stat is None:
+        stat = os.stat(video_path)
+    tmp_path = digest_path + '.tmp'
+    with open(tmp_path, 'w') as f:
+        json.dump({'size': stat.st_size, 'mtime_ns': stat.st_mtime_ns, 'crc32c': digest}, f)
+    os.replace(tmp_path, digest_path)
+
+
+def get_file_crc32c(filename):
+    """返回缓存的CRC32C；文件变化或没有缓存时在后台重新计算，本次返回None"""
+    if not CRC32C_AVAILABLE:
+        return None
+
+    video_path = os.path.join(UPLOAD_FOLDER, filename)
+    digest_path = os.path.join(DIGEST_FOLDER, filename + '.json')
+    try:
+        stat = os.stat(video_path)
+        with open(digest_path) as f:
+            cached = json.load(f)
+        if cached.get('size') == stat.st_size and cached.get('mtime_ns') == stat.st_mtime_ns:
+            return cached.get('crc32c')
+    except (OSError, ValueError):
+        pass
+
+    # 大文件计算需要时间，不阻塞当前下载
+    start_crc32c_job(filename)
+    return None
+
+
+def start_crc32c_job(filename):
+    """在后台线程计算视频的CRC32C，同一文件同时只有一个任务"""
+    video_path = os.path.join(UPLOAD_FOLDER, filename)
+    digest_path = os.path.join(DIGEST_FOLDER, filename + '.json')
+    with digest_jobs_lock:
+        if filename in digest_jobs_in_progress:
+            return
+        digest_jobs_in_progress.add(filename)
+
+    def worker():
+        try:
+            compute_file_crc32c(video_path, digest_path)
+        except OSError as e:
+            print(f"计算校验值失败 {filename}: {e}")
+        finally:
+            with digest_jobs_lock:
+                digest_jobs_in_progress.discard(filename)
+
+    threading.Thread(target=worker, daemon=True).start()
+
+
 def generate_default_thumbnail(thumbnail_path, size=(320, 180)):
     """生成一个默认的缩略图（灰色背景+播放图标）"""
     try:
@@ -132,7 +473,8 @@ def generate_default_thumbnail(thumbnail_path, size=(320, 180)):
         d.text((x_center, y_center + icon_size), text, fill=(150, 150, 150), anchor="mm")
 
         # 保存图片
-        img.save(thumbnail_path, 'JPEG', quality=90)
+        img.save(thumbnail_path, 'JPEG', quality=90, progressive=True)
+        store_thumbnail_placeholder(thumbnail_path)
         print(f"已生成默认缩略图: {thumbnail_path}")
         return True
     except Exception as e:
@@ -469,25 +811,20 @@ def upload_video():
         # 添加通知
         add_notification(upload_success_message, "success")
 
-        # 生成缩略图文件名
-        thumbnail_filename_for_this_video = new_filename_variable + '.jpg'
-
-        # 构建缩略图完整路径
-        thumbnail_full_path_string = os.path.join(THUMBNAIL_FOLDER, thumbnail_filename_for_this_video)
-
-        # 打印信息
-        print(f"正在为 {new_filename_variable} 生成缩略图...")
+        # 刚写入的文件还在页缓存中，在后台顺便算好下载校验值，不推迟响应
+        if CRC32C_AVAILABLE:
+            start_crc32c_job(new_filename_variable)
 
-        # 尝试生成缩略图
-        thumbnail_generation_result_flag = generate_video_thumbnail(final_filepath_string, thumbnail_full_path_string)
+        # 客户端附带的缩略图（thumbnail部分）和元数据（metadata部分，JSON）
+        thumbnail_part = request.files.get('thumbnail')
+        thumbnail_data = thumbnail_part.read(MAX_CLIENT_THUMBNAIL_SIZE + 1) if thumbnail_part else None
+        try:
+            metadata = json.loads(request.form.get('metadata', 'null'))
+        except ValueError:
+            metadata = None
 
-        # 检查生成结果
-        if thumbnail_generation_result_flag == True:
-            # 生成成功
-            add_notification(f"已生成缩略图: {thumbnail_filename_for_this_video}", "info")
-        else:
-            # 生成失败
-            add_notification(f"缩略图生成失败，使用默认缩略图", "warning")
+        # 客户端没有附带缩略图时才在服务器上解码视频
+        store_upload_thumbnail(new_filename_variable, final_filepath_string, thumbnail_data, metadata)
 
         # 构建返回数据字典
         response_data_dictionary = {}
@@ -525,6 +862,363 @@ def upload_video():
         return error_response_dict_3, http_status_code_3
 
 
+# 分块上传：init 返回上传ID，PUT 按块号写入暂存文件的对应偏移，commit 后移入视频目录
+# 会话状态保存在 staging/<id>.json，客户端断线或重启后用 GET /upload/<id> 查询已收到的块继续上传
+def unique_upload_filename(original_name):
+    """与普通上传相同的命名规则：重名时加 _1、_2 ..."""
+    base_name, extension = os.path.splitext(os.path.basename(original_name))
+    if not extension:
+        extension = '.mp4'
+
+    candidate = f"{base_name}{extension}"
+    counter = 1
+    while os.path.exists(os.path.join(UPLOAD_FOLDER, candidate)) and counter <= 1000:
+        candidate = f"{base_name}_{counter}{extension}"
+        counter += 1
+    return candidate
+
+
+def load_upload_session(upload_id):
+    """读取上传会话，ID格式不对或会话不存在时返回None"""
+    if not re.fullmatch(r'[0-9a-f]{32}', upload_id):
+        return None
+    try:
+        with open(os.path.join(STAGING_FOLDER, upload_id + '.json')) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return None
+
+
+def save_upload_session(session):
+    state_path = os.path.join(STAGING_FOLDER, session['upload_id'] + '.json')
+    with open(state_path + '.tmp', 'w') as f:
+        json.dump(session, f)
+    os.replace(state_path + '.tmp', state_path)
+
+
+def remove_stale_upload_sessions():
+    """删除超过保留期限的未完成上传"""
+    now = time.time()
+    for name in os.listdir(STAGING_FOLDER):
+        path = os.path.join(STAGING_FOLDER, name)
+        try:
+            if now - os.path.getmtime(path) > UPLOAD_SESSION_MAX_AGE:
+                os.remove(path)
+        except OSError:
+            pass
+
+
+def upload_chunk_count(session):
+    return max(1, (session['size'] + session['chunk_size'] - 1) // session['chunk_size'])
+
+
+@app.route('/upload/init', methods=['POST'])
+def init_chunked_upload():
+    params = request.get_json(silent=True) or {}
+    filename = os.path.basename(str(params.get('filename', '')))
+    size = params.get('size')
+
+    if not filename or not isinstance(size, int) or size < 0:
+        return {'error': '缺少文件名或文件大小'}, 400
+
+    remove_stale_upload_sessions()
+
+    session = {
+        'upload_id': uuid.uuid4().hex,
+        'filename': filename,
+        'size': size,
+        'chunk_size': UPLOAD_CHUNK_SIZE,
+        'received': [],
+        'client_ip': request.remote_addr,
+    }
+
+    # 预先设置暂存文件长度，各块可以按任意顺序写入
+    with open(os.path.join(STAGING_FOLDER, session['upload_id'] + '.part'), 'wb') as f:
+        f.truncate(size)
+    save_upload_session(session)
+
+    add_notification(f"用户 {request.remote_addr} 开始上传: {filename} ({size // 1024}KB)", "info")
+    return {'upload_id': session['upload_id'], 'chunk_size': session['chunk_size'], 'received': []}
+
+
+@app.route('/upload/<upload_id>', methods=['GET'])
+def get_chunked_upload(upload_id):
+    with upload_sessions_lock:
+        session = load_upload_session(upload_id)
+    if session is None:
+        return {'error': '上传会话不存在'}, 404
+    return session
+
+
+@app.route('/upload/<upload_id>/chunks/<int:index>', methods=['PUT'])
+def put_upload_chunk(upload_id, index):
+    with upload_sessions_lock:
+        session = load_upload_session(upload_id)
+    if session is None:
+        return {'error': '上传会话不存在'}, 404
+
+    chunk_size = session['chunk_size']
+    if index < 0 or index >= upload_chunk_count(session):
+        return {'error': '块号超出范围'}, 400
+
+    offset = index * chunk_size
+    expected_length = min(chunk_size, session['size'] - offset)
+    data = request.get_data(cache=False)
+    if len(data) != expected_length:
+        return {'error': f'块长度应为 {expected_length}，实际为 {len(data)}'}, 400
+
+    # 客户端附带了块的CRC32C时校验，不一致返回409让客户端重传
+    checksum = request.headers.get('X-Checksum-CRC32C')
+    if checksum and CRC32C_AVAILABLE and f"{crc32c_update(0, data):08x}" != checksum.lower():
+        return {'error': '块校验失败'}, 409
+
+    # 重试或重复的请求可能在提交之后才到达，此时暂存文件已被移走
+    try:
+        with open(os.path.join(STAGING_FOLDER, upload_id + '.part'), 'r+b') as f:
+            f.seek(offset)
+            f.write(data)
+    except FileNotFoundError:
+        return {'error': '上传会话不存在'}, 404
+
+    with upload_sessions_lock:
+        session = load_upload_session(upload_id)
+        if session is None:
+            return {'error': '上传会话不存在'}, 404
+        if index not in session['received']:
+            session['received'].append(index)
+            save_upload_session(session)
+        received_count = len(session['received'])
+
+    return {'index': index, 'received_count': received_count}
+
+
+@app.route('/upload/<upload_id>/commit', methods=['POST'])
+def commit_chunked_upload(upload_id):
+    thumbnail_data, metadata = parse_sidecar_params(request.get_json(silent=True) or {})
+
+    with upload_sessions_lock:
+        session = load_upload_session(upload_id)
+        if session is None:
+            return {'error': '上传会话不存在'}, 404
+
+        missing = sorted(set(range(upload_chunk_count(session))) - set(session['received']))
+        if missing:
+            return {'error': '还有未上传的块', 'missing': missing}, 409
+
+        # 在锁内确定文件名并移动，避免两个会话同时提交得到同一个名字
+        final_filename = unique_upload_filename(session['filename'])
+        final_path = os.path.join(UPLOAD_FOLDER, final_filename)
+        os.replace(os.path.join(STAGING_FOLDER, upload_id + '.part'), final_path)
+        os.remove(os.path.join(STAGING_FOLDER, upload_id + '.json'))
+
+    size_kb = session['size'] // 1024
+    add_notification(f"用户 {request.remote_addr} 上传了视频: {final_filename} ({size_kb}KB)", "success")
+
+    if CRC32C_AVAILABLE:
+        start_crc32c_job(final_filename)
+
+    store_upload_thumbnail(final_filename, final_path, thumbnail_data, metadata)
+
+    return {
+        'success': True,
+        'filename': final_filename,
+        'url': f'/video/{final_filename}',
+        'download_url': f'/download/{final_filename}',
+        'original_name': session['filename'],
+    }
+
+
+# 内容定义分块去重：客户端用FastCDC切块并计算SHA-256，先问服务器缺哪些块，只上传缺少的块
+# 已入库视频中的块记录在 chunks.db（块哈希 -> 视频文件和偏移），不另存一份；新上传的块先放在 chunk_staging/
+# 提交清单时按顺序拼出文件，整个文件已存在（清单相同）时直接返回已有的视频，不再保存 name_1.mp4
+def open_chunk_index():
+    """打开块索引数据库，每个请求单独连接"""
+    connection = sqlite3.connect(CHUNK_INDEX_PATH, timeout=30)
+    connection.execute('CREATE TABLE IF NOT EXISTS chunks (hash TEXT PRIMARY KEY, filename TEXT, offset INTEGER, length INTEGER)')
+    connection.execute('CREATE TABLE IF NOT EXISTS files (file_hash TEXT PRIMARY KEY, filename TEXT)')
+    return connection
+
+
+def is_chunk_hash(value):
+    return isinstance(value, str) and re.fullmatch(r'[0-9a-f]{64}', value) is not None
+
+
+def read_indexed_chunk(connection, chunk_hash):
+    """从已入库的视频中读出一个块，视频被修改过时删除失效的索引并返回None"""
+    row = connection.execute('SELECT filename, offset, length FROM chunks WHERE hash = ?', (chunk_hash,)).fetchone()
+    if row is None:
+        return None
+
+    filename, offset, length = row
+    try:
+        with open(os.path.join(UPLOAD_FOLDER, filename), 'rb') as f:
+            f.seek(offset)
+            data = f.read(length)
+    except OSError:
+        data = b''
+
+    if len(data) != length or hashlib.sha256(data).hexdigest() != chunk_hash:
+        connection.execute('DELETE FROM chunks WHERE hash = ?', (chunk_hash,))
+        connection.commit()
+        return None
+    return data
+
+
+def remove_stale_staged_chunks():
+    """删除超过保留期限、没有被任何清单引用的暂存块"""
+    now = time.time()
+    for name in os.listdir(CHUNK_STAGING_FOLDER):
+        path = os.path.join(CHUNK_STAGING_FOLDER, name)
+        try:
+            if now - os.path.getmtime(path) > UPLOAD_SESSION_MAX_AGE:
+                os.remove(path)
+        except OSError:
+            pass
+
+
+@app.route('/chunks/missing', methods=['POST'])
+def find_missing_chunks():
+    params = request.get_json(silent=True) or {}
+    hashes = params.get('hashes')
+    if not isinstance(hashes, list) or not all(is_chunk_hash(h) for h in hashes):
+        return {'error': '块哈希格式错误'}, 400
+
+    remove_stale_staged_chunks()
+
+    connection = open_chunk_index()
+    try:
+        indexed = set()
+        unique_hashes = list(dict.fromkeys(hashes))
+        for start in range(0, len(unique_hashes), 500):
+            batch = unique_hashes[start:start + 500]
+            placeholders = ','.join('?' * len(batch))
+            rows = connection.execute(f'SELECT hash FROM chunks WHERE hash IN ({placeholders})', batch)
+            indexed.update(row[0] for row in rows)
+    finally:
+        connection.close()
+
+    missing = [h for h in unique_hashes
+               if h not in indexed and not os.path.exists(os.path.join(CHUNK_STAGING_FOLDER, h))]
+    return {'missing': missing}
+
+
+@app.route('/chunks/<chunk_hash>', methods=['PUT'])
+def put_chunk(chunk_hash):
+    if not is_chunk_hash(chunk_hash):
+        return {'error': '块哈希格式错误'}, 400
+
+    data = request.get_data(cache=False)
+    if hashlib.sha256(data).hexdigest() != chunk_hash:
+        return {'error': '块校验失败'}, 409
+
+    # 先写临时文件再改名，同一个块被并发上传时不会读到半个文件
+    chunk_path = os.path.join(CHUNK_STAGING_FOLDER, chunk_hash)
+    tmp_path = f"{chunk_path}.{uuid.uuid4().hex}.tmp"
+    with open(tmp_path, 'wb') as f:
+        f.write(data)
+    os.replace(tmp_path, chunk_path)
+    return {'hash': chunk_hash, 'length': len(data)}
+
+
+@app.route('/upload/manifest', methods=['POST'])
+def commit_upload_manifest():
+    params = request.get_json(silent=True) or {}
+    filename = os.path.basename(str(params.get('filename', '')))
+    size = params.get('size')
+    chunk_hashes = params.get('chunks')
+
+    if not filename or not isinstance(size, int) or not isinstance(chunk_hashes, list) \
+            or not all(is_chunk_hash(h) for h in chunk_hashes):
+        return {'error': '清单格式错误'}, 400
+
+    file_hash = hashlib.sha256(''.join(chunk_hashes).encode()).hexdigest()
+    connection = open_chunk_index()
+    try:
+        # 同样的内容已经入库：直接返回已有的视频
+        row = connection.execute('SELECT filename FROM files WHERE file_hash = ?', (file_hash,)).fetchone()
+        if row and os.path.exists(os.path.join(UPLOAD_FOLDER, row[0])) \
+                and os.path.getsize(os.path.join(UPLOAD_FOLDER, row[0])) == size:
+            existing_filename = row[0]
+            add_notification(f"用户 {request.remote_addr} 上传的 {filename} 与已有视频 {existing_filename} 相同，未重复保存", "info")
+            return {
+                'success': True,
+                'filename': existing_filename,
+                'url': f'/video/{existing_filename}',
+                'download_url': f'/download/{existing_filename}',
+                'original_name': filename,
+                'deduplicated': True,
+            }
+
+        # 按清单顺序拼出文件，同时计算整个文件的CRC32C
+        staging_path = os.path.join(STAGING_FOLDER, uuid.uuid4().hex + '.part')
+        chunk_offsets = []
+        missing = []
+        crc = 0
+        offset = 0
+        with open(staging_path, 'wb') as out:
+            for chunk_hash in chunk_hashes:
+                data = None
+                staged_path = os.path.join(CHUNK_STAGING_FOLDER, chunk_hash)
+                if os.path.exists(staged_path):
+                    with open(staged_path, 'rb') as f:
+                        data = f.read()
+                if data is None:
+                    data = read_indexed_chunk(connection, chunk_hash)
+                if data is None:
+                    missing.append(chunk_hash)
+                    continue
+                if missing:
+                    continue
+
+                out.write(data)
+                if CRC32C_AVAILABLE:
+                    crc = crc32c_update(crc, data)
+                chunk_offsets.append((chunk_hash, offset, len(data)))
+                offset += len(data)
+
+        if missing or offset != size:
+            os.remove(staging_path)
+            if missing:
+                return {'error': '还有未上传的块', 'missing': list(dict.fromkeys(missing))}, 409
+            return {'error': f'文件大小应为 {size}，实际为 {offset}'}, 400
+
+        with upload_sessions_lock:
+            final_filename = unique_upload_filename(filename)
+            final_path = os.path.join(UPLOAD_FOLDER, final_filename)
+            os.replace(staging_path, final_path)
+
+        # 记录新视频中每个块的位置，之后的上传可以引用
+        connection.executemany('INSERT OR IGNORE INTO chunks (hash, filename, offset, length) VALUES (?, ?, ?, ?)',
+                               [(h, final_filename, o, n) for h, o, n in chunk_offsets])
+        connection.execute('INSERT OR REPLACE INTO files (file_hash, filename) VALUES (?, ?)', (file_hash, final_filename))
+        connection.commit()
+    finally:
+        connection.close()
+
+    # 块已经进入视频文件，暂存副本不再需要
+    for chunk_hash in set(chunk_hashes):
+        try:
+            os.remove(os.path.join(CHUNK_STAGING_FOLDER, chunk_hash))
+        except OSError:
+            pass
+
+    if CRC32C_AVAILABLE:
+        save_file_crc32c(final_path, os.path.join(DIGEST_FOLDER, final_filename + '.json'), f"{crc:08x}")
+
+    add_notification(f"用户 {request.remote_addr} 上传了视频: {final_filename} ({size // 1024}KB)", "success")
+
+    thumbnail_data, metadata = parse_sidecar_params(params)
+    store_upload_thumbnail(final_filename, final_path, thumbnail_data, metadata)
+
+    return {
+        'success': True,
+        'filename': final_filename,
+        'url': f'/video/{final_filename}',
+        'download_url': f'/download/{final_filename}',
+        'original_name': filename,
+    }
+
+
 # # 测试代码
 # # print("测试上传接口")
 # # test_data = {'test': 'data'}
@@ -608,7 +1302,13 @@ def download_video(filename):
         # return send_file(full_path, as_attachment=True)
 
         # 下载文件，带文件名
-        result = send_file(full_path, as_attachment=True, download_name=filename)
+        # conditional=True 让 werkzeug 处理 Range / If-Range，返回 206 和 ETag，客户端据此断点续传
+        result = send_file(full_path, as_attachment=True, download_name=filename, conditional=True, etag=True)
+
+        # 整个文件的CRC32C，客户端边下载边校验（206分段响应也返回整个文件的值）
+        digest = get_file_crc32c(filename)
+        if digest:
+            result.headers['X-Checksum-CRC32C'] = digest
         return result
 
     # 文件不存在
@@ -631,8 +1331,186 @@ def download_video(filename):
 # #     print("测试失败")```
 
 # 6. 视频列表接口 - 获取视频文件列表
+def build_video_info(video_filename):
+    """构建视频列表中一个视频的信息；缩略图不存在时现场生成"""
+    # 处理缩略图 - 先构建缩略图文件名
+    thumbnail_file_name_without_path = video_filename + '.jpg'
+
+    # 构建缩略图完整路径
+    full_thumbnail_path_string = os.path.join(THUMBNAIL_FOLDER, thumbnail_file_name_without_path)
+
+    # 检查缩略图是否存在
+    thumbnail_exists_flag = os.path.exists(full_thumbnail_path_string)
+
+    # 如果不存在，尝试生成
+    if thumbnail_exists_flag == False:
+        # 构建视频文件的完整路径
+        video_file_full_path = os.path.join(UPLOAD_FOLDER, video_filename)
+
+        # 检查视频文件是否存在
+        video_file_exists_check = os.path.exists(video_file_full_path)
+
+        if video_file_exists_check:
+            # 打印日志
+            print(f"正在为视频文件 {video_filename} 生成缩略图...")
+
+            # 尝试生成缩略图
+            thumbnail_generation_result = generate_video_thumbnail(video_file_full_path,
+                                                                   full_thumbnail_path_string)
+
+            # 检查生成结果
+            if thumbnail_generation_result == False:
+                # 如果生成失败，生成默认缩略图
+                default_thumbnail_creation_result = generate_default_thumbnail(full_thumbnail_path_string)
+                # 这里不管结果如何都继续
+        else:
+            # 如果视频文件不存在，也生成默认缩略图
+            generate_default_thumbnail(full_thumbnail_path_string)
+
+    # 获取文件大小 - 先初始化
+    file_size_in_kilobytes = 0
+
+    try:
+        # 构建视频文件路径
+        path_for_size_check = os.path.join(UPLOAD_FOLDER, video_filename)
+
+        # 检查文件是否存在
+        if os.path.exists(path_for_size_check):
+            # 获取文件大小（字节）
+            file_size_in_bytes = os.path.getsize(path_for_size_check)
+
+            # 转换为KB
+            file_size_in_kilobytes = file_size_in_bytes // 1024
+        else:
+            file_size_in_kilobytes = 0
+    except Exception as error:
+        # 出错时设置为0
+        file_size_in_kilobytes = 0
+        # 这里不处理错误
+
+    # 构建视频信息字典
+    video_info_dict = {}
+
+    # 设置各个字段
+    video_info_dict['name'] = video_filename
+    video_info_dict['author'] = '上传者'  # 固定值，后面可以改
+
+    # 构建URL
+    video_info_dict['url'] = f'/video/{video_filename}'
+
+    # 构建下载URL
+    video_info_dict['download_url'] = f'/download/{video_filename}'
+
+    # 设置文件大小
+    video_info_dict['size'] = f"{file_size_in_kilobytes}KB"
+
+    # 设置缩略图URL
+    video_info_dict['thumbnail'] = f'/preview/{video_filename}'
+
+    # 缩略图加载前显示的模糊占位图
+    placeholder = load_thumbnail_placeholder(full_thumbnail_path_string)
+    if placeholder:
+        video_info_dict['blurhash'] = placeholder
+
+    # 客户端上传时附带的时长和分辨率
+    metadata_path = os.path.join(METADATA_FOLDER, video_filename + '.json')
+    if os.path.exists(metadata_path):
+        try:
+            with open(metadata_path) as f:
+                video_info_dict.update(json.load(f))
+        except (OSError, ValueError):
+            pass
+
+    return video_info_dict
+
+
+def get_video_catalog():
+    """
+    返回按上传时间从新到旧排列的 [(-修改时间ns, 文件名)]，同一时间按文件名排序
+    只在视频文件夹的修改时间变化（增加、删除、改名）时重新扫描，扫描时只为新出现的文件读取修改时间；
+    已有的视频（文件名和inode都相同）沿用第一次看到时的时间，仍在写入的文件不会在两页之间改变位置
+    """
+    folder_mtime = os.stat(UPLOAD_FOLDER).st_mtime_ns
+    with video_catalog_lock:
+        if video_catalog['folder_mtime'] == folder_mtime:
+            return video_catalog['entries']
+
+        known_times = video_catalog['times']
+        times = {}
+        with os.scandir(UPLOAD_FOLDER) as entries:
+            for entry in entries:
+                if not entry.name.lower().endswith(VIDEO_EXTENSIONS):
+                    continue
+                # 以(文件名, inode)为键，删除后同名重新上传的视频会重新读取时间排到最前
+                try:
+                    key = (entry.name, entry.inode())
+                except OSError:
+                    continue
+                mtime = known_times.get(key)
+                if mtime is None:
+                    try:
+                        mtime = entry.stat().st_mtime_ns
+                    except OSError:
+                        continue
+                times[key] = mtime
+
+        # 整个列表替换而不修改，已返回给其他请求的列表不受影响
+        video_catalog['folder_mtime'] = folder_mtime
+        video_catalog['times'] = times
+        video_catalog['entries'] = sorted((-mtime, name) for (name, _), mtime in times.items())
+        return video_catalog['entries']
+
+
+def encode_catalog_cursor(key):
+    """游标为上一页最后一个视频的排序键，base64编码后客户端原样传回"""
+    text = f"{-key[0]}:{key[1]}"
+    return base64.urlsafe_b64encode(text.encode('utf-8')).decode('ascii').rstrip('=')
+
+
+def decode_catalog_cursor(cursor):
+    """解析游标，格式不正确时抛出ValueError"""
+    try:
+        text = base64.urlsafe_b64decode(cursor + '=' * (-len(cursor) % 4)).decode('utf-8')
+    except (ValueError, UnicodeDecodeError) as error:
+        raise ValueError('cursor') from error
+    mtime, separator, name = text.partition(':')
+    if not separator or not name:
+        raise ValueError('cursor')
+    return -int(mtime), name
+
+
+def list_videos_page():
+    """
+    按上传时间从新到旧返回一页视频，cursor为上一页返回的next_cursor，没有更多时next_cursor为null
+    游标按排序键定位而不是按序号，翻页期间新上传的视频排在第一页之前，不会使后面的页重复或遗漏
+    只为本页的视频读取大小、缩略图和元数据，第一页的耗时与视频总数无关
+    """
+    try:
+        limit = int(request.args.get('limit', VIDEO_PAGE_DEFAULT_SIZE))
+        if not (1 <= limit <= MAX_VIDEO_PAGE_SIZE):
+            raise ValueError('limit')
+        cursor = request.args.get('cursor')
+        after = decode_catalog_cursor(cursor) if cursor else None
+    except ValueError:
+        return {'error': '分页参数错误'}, 400
+
+    catalog = get_video_catalog()
+    start = bisect.bisect_right(catalog, after) if after else 0
+    page = catalog[start:start + limit]
+    if after is None:
+        add_notification(f"用户 {request.remote_addr} 查看了视频列表 (共{len(catalog)}个视频)", "info")
+
+    videos = [build_video_info(name) for _, name in page]
+    next_cursor = encode_catalog_cursor(page[-1]) if start + limit < len(catalog) else None
+    return {'videos': videos, 'next_cursor': next_cursor, 'total': len(catalog)}
+
+
 @app.route('/videos')
 def list_videos():
+    # 带limit或cursor时分页返回，否则按原来的方式返回全部视频
+    if 'limit' in request.args or 'cursor' in request.args:
+        return list_videos_page()
+
     # 开始处理视频列表请求
     try:
         # 获取文件夹里的所有文件
@@ -680,79 +1558,7 @@ def list_videos():
 
         # 处理每个视频文件
         for video_filename in video_files_that_are_videos:
-            # 处理缩略图 - 先构建缩略图文件名
-            thumbnail_file_name_without_path = video_filename + '.jpg'
-
-            # 构建缩略图完整路径
-            full_thumbnail_path_string = os.path.join(THUMBNAIL_FOLDER, thumbnail_file_name_without_path)
-
-            # 检查缩略图是否存在
-            thumbnail_exists_flag = os.path.exists(full_thumbnail_path_string)
-
-            # 如果不存在，尝试生成
-            if thumbnail_exists_flag == False:
-                # 构建视频文件的完整路径
-                video_file_full_path = os.path.join(UPLOAD_FOLDER, video_filename)
-
-                # 检查视频文件是否存在
-                video_file_exists_check = os.path.exists(video_file_full_path)
-
-                if video_file_exists_check:
-                    # 打印日志
-                    print(f"正在为视频文件 {video_filename} 生成缩略图...")
-
-                    # 尝试生成缩略图
-                    thumbnail_generation_result = generate_video_thumbnail(video_file_full_path,
-                                                                           full_thumbnail_path_string)
-
-                    # 检查生成结果
-                    if thumbnail_generation_result == False:
-                        # 如果生成失败，生成默认缩略图
-                        default_thumbnail_creation_result = generate_default_thumbnail(full_thumbnail_path_string)
-                        # 这里不管结果如何都继续
-                else:
-                    # 如果视频文件不存在，也生成默认缩略图
-                    generate_default_thumbnail(full_thumbnail_path_string)
-
-            # 获取文件大小 - 先初始化
-            file_size_in_kilobytes = 0
-
-            try:
-                # 构建视频文件路径
-                path_for_size_check = os.path.join(UPLOAD_FOLDER, video_filename)
-
-                # 检查文件是否存在
-                if os.path.exists(path_for_size_check):
-                    # 获取文件大小（字节）
-                    file_size_in_bytes = os.path.getsize(path_for_size_check)
-
-                    # 转换为KB
-                    file_size_in_kilobytes = file_size_in_bytes // 1024
-                else:
-                    file_size_in_kilobytes = 0
-            except Exception as error:
-                # 出错时设置为0
-                file_size_in_kilobytes = 0
-                # 这里不处理错误
-
-            # 构建视频信息字典
-            video_info_dict = {}
-
-            # 设置各个字段
-            video_info_dict['name'] = video_filename
-            video_info_dict['author'] = '上传者'  # 固定值，后面可以改
-
-            # 构建URL
-            video_info_dict['url'] = f'/video/{video_filename}'
-
-            # 构建下载URL
-            video_info_dict['download_url'] = f'/download/{video_filename}'
-
-            # 设置文件大小
-            video_info_dict['size'] = f"{file_size_in_kilobytes}KB"
-
-            # 设置缩略图URL
-            video_info_dict['thumbnail'] = f'/preview/{video_filename}'
+            video_info_dict = build_video_info(video_filename)
 
             # 添加到最终列表
             final_video_information_list.append(video_info_dict)
@@ -797,8 +1603,15 @@ def get_preview(filename):
     这个函数用来获取视频的预览图片
     它会先检查有没有现成的缩略图，如果没有就现场生成
     如果生成失败就用默认图片
+    可选参数 w、h、dpr：返回缩放到 w*dpr x h*dpr 以内的版本，与客户端实际绘制的像素数一致
     """
 
+    # 尺寸参数不合法时直接返回错误，不退回到默认图片
+    try:
+        parse_preview_variant_size(request.args)
+    except ValueError:
+        return {'error': '尺寸参数错误'}, 400
+
     # 第一步：处理传入的文件名参数
     input_filename_parameter = filename
 
@@ -829,11 +1642,8 @@ def get_preview(filename):
             # 创建一个变量来存储发送结果
             send_result = None
 
-            # 发送文件
-            send_result = send_file(
-                thumbnail_complete_path_string,
-                mimetype='image/jpeg'
-            )
+            # 发送文件，请求指定了尺寸时发送缩放后的版本
+            send_result = send_thumbnail(thumbnail_complete_path_string)
 
             # 检查发送结果
             if send_result is not None:
@@ -881,10 +1691,7 @@ def get_preview(filename):
             if os.path.exists(thumbnail_complete_path_string):
                 try:
                     # 返回新生成的缩略图
-                    return send_file(
-                        thumbnail_complete_path_string,
-                        mimetype='image/jpeg'
-                    )
+                    return send_thumbnail(thumbnail_complete_path_string)
                 except:
                     # 如果发送失败，继续向下执行
                     pass  # 什么都不做
@@ -967,6 +1774,71 @@ def get_preview(filename):
 
 
 
+# 7.1 缩略图拼图接口 - 一次请求取回一屏视频的缩略图
+@app.route('/previews')
+def get_preview_atlas():
+    """
+    GET /previews?f=<文件名>&f=<文件名>...&w=<宽>&h=<高>
+    把已有的缩略图按请求顺序缩放到 w x h 以内，拼成一张JPEG
+    X-Atlas-Index 头中是各缩略图在拼图中的位置 [x, y, 宽, 高]，没有缩略图的文件不在其中，由客户端单独请求 /preview
+    ETag由各缩略图的修改时间计算，客户端缓存重新请求时未变化只返回304
+    """
+    names = request.args.getlist('f')[:MAX_ATLAS_TILES]
+    try:
+        tile_width = min(max(int(request.args.get('w', 160)), 16), MAX_ATLAS_TILE_SIZE[0])
+        tile_height = min(max(int(request.args.get('h', 90)), 16), MAX_ATLAS_TILE_SIZE[1])
+    except ValueError:
+        return {'error': '尺寸参数错误'}, 400
+
+    entries = []
+    for name in names:
+        thumbnail_path = os.path.join(THUMBNAIL_FOLDER, os.path.basename(name) + '.jpg')
+        try:
+            stat = os.stat(thumbnail_path)
+        except OSError:
+            continue
+        entries.append((name, thumbnail_path, stat))
+
+    etag_source = f"{tile_width}x{tile_height}|" + '|'.join(
+        f"{name}:{stat.st_mtime_ns}:{stat.st_size}" for name, _, stat in entries)
+    etag = hashlib.sha1(etag_source.encode('utf-8')).hexdigest()
+    if etag in request.if_none_match:
+        response = app.response_class(status=304)
+        response.set_etag(etag)
+        response.cache_control.no_cache = True
+        return response
+
+    # 每行8格；读不出的缩略图跳过
+    columns = max(1, min(len(entries), 8))
+    rows = max(1, (len(entries) + columns - 1) // columns)
+    atlas = Image.new('RGB', (columns * tile_width, rows * tile_height), color=(230, 230, 230))
+    tiles = {}
+    for position, (name, thumbnail_path, _) in enumerate(entries):
+        try:
+            with Image.open(thumbnail_path) as thumbnail:
+                tile = thumbnail.convert('RGB')
+                tile.thumbnail((tile_width, tile_height))
+        except Exception as e:
+            print(f"读取缩略图失败: {thumbnail_path}: {e}")
+            continue
+        x = (position % columns) * tile_width
+        y = (position // columns) * tile_height
+        atlas.paste(tile, (x, y))
+        tiles[name] = [x, y, tile.width, tile.height]
+
+    atlas_bytes = io.BytesIO()
+    # 渐进式：整张拼图较大，慢速网络下先显示所有格子的粗略版本
+    atlas.save(atlas_bytes, format='JPEG', quality=85, progressive=True)
+    atlas_bytes.seek(0)
+
+    response = send_file(atlas_bytes, mimetype='image/jpeg')
+    response.set_etag(etag)
+    response.cache_control.no_cache = True
+    response.headers['X-Atlas-Index'] = json.dumps(
+        {'tile_width': tile_width, 'tile_height': tile_height, 'tiles': tiles}, ensure_ascii=True)
+    return response
+
+
 # # 测试代码
 # test_preview = get_preview("test.mp4")
 # print("预览接口测试完成")